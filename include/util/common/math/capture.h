@@ -0,0 +1,623 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#include <util/common/math/common.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                  capture format                   */
+    /*****************************************************/
+
+    /**
+     * Binary capture of a sampled signal: a fixed 64-byte
+     * little-endian header followed by `count` frames of
+     * `channels` interleaved samples each.
+     *
+     * The header and the samples are written and mapped in
+     * the host byte order, so the host must be little-endian
+     * (all the supported targets are); big-endian hosts are
+     * rejected at compile time. The payload offset is
+     * a multiple of 8, so the mapped samples stay aligned.
+     */
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    #error "capture.h: the capture format requires a little-endian host"
+#endif
+
+    enum capture_dtype
+    {
+        capture_float64 = 0,
+        capture_float32 = 1
+    };
+
+    struct capture_header
+    {
+        /* "UCAP" */
+        char     magic[4];
+        uint32_t version;
+        uint32_t dtype;
+        uint32_t channels;
+        /* frames in the payload */
+        uint64_t count;
+        double   period;
+        /* payload offset */
+        uint64_t header_size;
+        uint8_t  reserved[24];
+    };
+
+    static_assert(sizeof(capture_header) == 64, "capture_header must be 64 bytes");
+
+    inline size_t capture_sample_size(uint32_t dtype)
+    {
+        return (dtype == capture_float32) ? sizeof(float) : sizeof(double);
+    }
+
+    inline capture_header make_capture_header(double period, size_t channels, capture_dtype dtype)
+    {
+        capture_header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, "UCAP", 4);
+        h.version = 1;
+        h.dtype = (uint32_t) dtype;
+        h.channels = (uint32_t) channels;
+        h.count = 0;
+        h.period = period;
+        h.header_size = sizeof(capture_header);
+        return h;
+    }
+
+    inline bool is_valid_capture_header(const capture_header & h)
+    {
+        return (std::memcmp(h.magic, "UCAP", 4) == 0)
+            && (h.version == 1)
+            && ((h.dtype == capture_float64) || (h.dtype == capture_float32))
+            && (h.channels > 0)
+            && (h.header_size >= sizeof(capture_header))
+            && (h.header_size % 8 == 0);
+    }
+
+    /*****************************************************/
+    /*                  capture_writer                   */
+    /*****************************************************/
+
+    /**
+     * Appends frames to a capture file.
+     *
+     * The frame count in the header is patched in place on
+     * `flush()` and on destruction, the payload is never
+     * rewritten. Opening an existing file in the append mode
+     * continues it if the period, channels and dtype match.
+     */
+    class capture_writer
+    {
+
+    private:
+
+        std::fstream file;
+        capture_header h;
+        std::vector < float > convert;
+
+    public:
+
+        capture_writer()
+        {
+            h = make_capture_header(0, 1, capture_float64);
+        }
+
+        capture_writer(const std::string & path, double period,
+                       size_t channels = 1, capture_dtype dtype = capture_float64,
+                       bool append = false)
+        {
+            open(path, period, channels, dtype, append);
+        }
+
+        ~capture_writer()
+        {
+            close();
+        }
+
+        bool open(const std::string & path, double period,
+                  size_t channels = 1, capture_dtype dtype = capture_float64,
+                  bool append = false)
+        {
+            close();
+            h = make_capture_header(period, channels, dtype);
+            if (append)
+            {
+                file.open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+                if (file.is_open())
+                {
+                    capture_header existing;
+                    file.read((char *) &existing, sizeof(existing));
+                    if (!file || !is_valid_capture_header(existing)
+                        || (existing.period != period)
+                        || (existing.channels != h.channels)
+                        || (existing.dtype != h.dtype))
+                    {
+                        file.close();
+                        return false;
+                    }
+                    h = existing;
+                    /* drop a partially written trailing frame */
+                    file.seekp((std::streamoff) (h.header_size + h.count * _frame_size()));
+                    return (bool) file;
+                }
+            }
+            file.clear();
+            file.open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return false;
+            file.write((const char *) &h, sizeof(h));
+            return (bool) file;
+        }
+
+        bool is_open() const { return file.is_open(); }
+
+        uint64_t count() const { return h.count; }
+
+        size_t channels() const { return h.channels; }
+
+        /**
+         * Appends `frames` frames of `channels()`
+         * interleaved samples.
+         */
+        bool write(const double * samples, size_t frames)
+        {
+            assert(is_open());
+            size_t n = frames * h.channels;
+            if (h.dtype == capture_float32)
+            {
+                convert.assign(samples, samples + n);
+                file.write((const char *) convert.data(), n * sizeof(float));
+            }
+            else
+            {
+                file.write((const char *) samples, n * sizeof(double));
+            }
+            if (!file) return false;
+            h.count += frames;
+            return true;
+        }
+
+        /**
+         * Appends a single-channel block.
+         */
+        bool write(const sampled_t & block)
+        {
+            assert(h.channels == 1);
+            assert(abs(block.period - h.period) < 1e-15);
+            return write(block.samples, block.count);
+        }
+
+        /**
+         * Makes the appended frames visible to the readers.
+         */
+        bool flush()
+        {
+            if (!is_open()) return false;
+            std::streamoff end = file.tellp();
+            file.seekp((std::streamoff) offsetof(capture_header, count));
+            file.write((const char *) &h.count, sizeof(h.count));
+            file.seekp(end);
+            file.flush();
+            return (bool) file;
+        }
+
+        void close()
+        {
+            if (!is_open()) return;
+            flush();
+            file.close();
+        }
+
+    private:
+
+        capture_writer(const capture_writer &);
+        capture_writer & operator = (const capture_writer &);
+
+        uint64_t _frame_size() const
+        {
+            return h.channels * capture_sample_size(h.dtype);
+        }
+    };
+
+    /*****************************************************/
+    /*                  capture_reader                   */
+    /*****************************************************/
+
+    class capture_cursor;
+
+    /**
+     * Memory-mapped access to a capture file.
+     *
+     * Nothing but the header is mapped on `open`: `chunks`
+     * maps a sliding window of the file per cursor, so
+     * captures much larger than the free address space are
+     * read in constant memory; `view` maps the whole payload
+     * of a single-channel float64 capture as a zero-copy
+     * `sampled_t` and fails if the payload does not fit in
+     * the address space. The frame counts and positions are
+     * 64-bit, so captures over 4 GB open on 32-bit targets.
+     *
+     * The mappings are copy-on-write: the returned samples
+     * may be modified in place (e.g. by the functions of
+     * `common.h`), the changes stay private to the process
+     * and never reach the file.
+     *
+     * The frame count is limited by the file size, so
+     * a capture that is still being written is safe to open.
+     */
+    class capture_reader
+    {
+
+        friend class capture_cursor;
+
+    private:
+
+        capture_header h;
+        uint64_t size;
+        uint64_t frames;
+        size_t granularity;
+
+        /* the whole payload mapping of `view` */
+        char * view_base;
+        size_t view_length;
+
+    #ifdef _WIN32
+        HANDLE file, mapping;
+    #else
+        int fd;
+    #endif
+
+    public:
+
+        capture_reader()
+            : size(0), frames(0), granularity(0)
+            , view_base(nullptr), view_length(0)
+        #ifdef _WIN32
+            , file(INVALID_HANDLE_VALUE), mapping(NULL)
+        #else
+            , fd(-1)
+        #endif
+        {
+        }
+
+        explicit capture_reader(const std::string & path)
+            : size(0), frames(0), granularity(0)
+            , view_base(nullptr), view_length(0)
+        #ifdef _WIN32
+            , file(INVALID_HANDLE_VALUE), mapping(NULL)
+        #else
+            , fd(-1)
+        #endif
+        {
+            open(path);
+        }
+
+        ~capture_reader()
+        {
+            close();
+        }
+
+        bool open(const std::string & path)
+        {
+            close();
+            if (!_open(path) || (size < sizeof(capture_header))) { close(); return false; }
+            size_t offset;
+            char * p = _map(0, sizeof(capture_header), offset);
+            if (p == nullptr) { close(); return false; }
+            std::memcpy(&h, p + offset, sizeof(h));
+            _unmap(p, offset + sizeof(capture_header));
+            if (!is_valid_capture_header(h) || (h.header_size > size)) { close(); return false; }
+            uint64_t available = (size - h.header_size) / _frame_size();
+            frames = (std::min)(h.count, available);
+            return true;
+        }
+
+        void close()
+        {
+            if (view_base != nullptr) _unmap(view_base, view_length);
+            view_base = nullptr;
+            view_length = 0;
+        #ifdef _WIN32
+            if (mapping != NULL) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = NULL;
+            file = INVALID_HANDLE_VALUE;
+        #else
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        #endif
+            size = 0;
+            frames = 0;
+        }
+
+        bool is_open() const
+        {
+        #ifdef _WIN32
+            return mapping != NULL;
+        #else
+            return fd >= 0;
+        #endif
+        }
+
+        const capture_header & header() const { return h; }
+
+        uint64_t count() const { return frames; }
+
+        size_t channels() const { return h.channels; }
+
+        double period() const { return h.period; }
+
+        capture_dtype dtype() const { return (capture_dtype) h.dtype; }
+
+        /**
+         * Zero-copy, copy-on-write view of a single-channel
+         * float64 capture, valid until `close()`.
+         *
+         * Returns:
+         *      false if the layout requires a conversion,
+         *      the payload exceeds `SIZE_MAX` bytes or cannot
+         *      be mapped at once
+         */
+        bool view(sampled_t & out)
+        {
+            if (!is_open() || (h.channels != 1) || (h.dtype != capture_float64)) return false;
+            if (frames > (SIZE_MAX - granularity) / sizeof(double)) return false;
+            size_t length = (size_t) frames * sizeof(double);
+            out.count = (size_t) frames;
+            out.period = h.period;
+            out.samples = nullptr;
+            if (frames == 0) return true;
+            size_t offset = 0;
+            if (view_base == nullptr)
+            {
+                view_base = _map(h.header_size, length, offset);
+                if (view_base == nullptr) return false;
+                view_length = offset + length;
+            }
+            else
+            {
+                offset = (size_t) (h.header_size % granularity);
+            }
+            out.samples = (double *) (view_base + offset);
+            return true;
+        }
+
+        /**
+         * Iterates over `channel` in chunks of `frames` samples.
+         */
+        capture_cursor chunks(size_t frames, size_t channel = 0) const;
+
+    private:
+
+        capture_reader(const capture_reader &);
+        capture_reader & operator = (const capture_reader &);
+
+        uint64_t _frame_size() const
+        {
+            return h.channels * capture_sample_size(h.dtype);
+        }
+
+        bool _open(const std::string & path)
+        {
+        #ifdef _WIN32
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            granularity = si.dwAllocationGranularity;
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER li;
+            if (!GetFileSizeEx(file, &li) || (li.QuadPart == 0)) return false;
+            size = (uint64_t) li.QuadPart;
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            return mapping != NULL;
+        #else
+            granularity = (size_t) sysconf(_SC_PAGESIZE);
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat st;
+            if ((fstat(fd, &st) != 0) || (st.st_size == 0)) return false;
+            size = (uint64_t) st.st_size;
+            return true;
+        #endif
+        }
+
+        /* maps `length` bytes at `at` copy-on-write from the
+           allocation granularity boundary below it, `offset`
+           is the distance to `at`; null on failure */
+        char * _map(uint64_t at, size_t length, size_t & offset) const
+        {
+            uint64_t aligned = at - at % granularity;
+            offset = (size_t) (at - aligned);
+            length += offset;
+        #ifdef _WIN32
+            void * p = MapViewOfFile(mapping, FILE_MAP_COPY,
+                                     (DWORD) (aligned >> 32), (DWORD) aligned, length);
+            return (char *) p;
+        #else
+            void * p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t) aligned);
+            if (p == MAP_FAILED) return nullptr;
+            madvise(p, length, MADV_SEQUENTIAL);
+            return (char *) p;
+        #endif
+        }
+
+        static void _unmap(char * base, size_t length)
+        {
+        #ifdef _WIN32
+            UnmapViewOfFile(base);
+        #else
+            munmap(base, length);
+        #endif
+        }
+    };
+
+    /*****************************************************/
+    /*                  capture_cursor                   */
+    /*****************************************************/
+
+    /**
+     * Sequential chunked access to one channel of a capture.
+     *
+     *      capture_cursor c = reader.chunks(4096);
+     *      sampled_t chunk;
+     *      while (c.next(chunk)) process(chunk);
+     *
+     * The cursor maps a window of at least `window` bytes
+     * around the current chunk and slides it forward when
+     * a chunk leaves it. Chunks of single-channel float64
+     * captures point into the (copy-on-write) window, the
+     * others are converted into a buffer owned by the
+     * cursor; either way a chunk is valid until the next
+     * call. The cursor must not outlive the reader.
+     */
+    class capture_cursor
+    {
+
+    private:
+
+        const capture_reader * reader;
+        size_t chunk, channel;
+        uint64_t pos;
+        size_t window_size;
+        std::vector < double > buffer;
+
+        /* the mapped window, `[window_begin, window_end)`
+           in the file, `window_base` maps from the granularity
+           boundary `window_begin - window_offset` */
+        char * window_base;
+        size_t window_offset, window_length;
+        uint64_t window_begin, window_end;
+
+    public:
+
+        /* the default minimal window (bytes) */
+        static size_t default_window() { return 16 << 20; }
+
+        capture_cursor(const capture_reader & reader, size_t frames, size_t channel,
+                       size_t window = default_window())
+            : reader(&reader), chunk(frames), channel(channel), pos(0)
+            , window_size(window)
+            , window_base(nullptr), window_offset(0), window_length(0)
+            , window_begin(0), window_end(0)
+        {
+            assert(frames > 0);
+            assert(channel < reader.channels());
+        }
+
+        capture_cursor(capture_cursor && other)
+            : reader(other.reader), chunk(other.chunk), channel(other.channel), pos(other.pos)
+            , window_size(other.window_size)
+            , window_base(other.window_base), window_offset(other.window_offset)
+            , window_length(other.window_length)
+            , window_begin(other.window_begin), window_end(other.window_end)
+        {
+            buffer.swap(other.buffer);
+            other.window_base = nullptr;
+        }
+
+        ~capture_cursor()
+        {
+            _release();
+        }
+
+        /* the frame index of the next chunk */
+        uint64_t position() const { return pos; }
+
+        void rewind() { pos = 0; }
+
+        /**
+         * Returns:
+         *      false at the end of the capture or if
+         *      the window cannot be mapped
+         */
+        bool next(sampled_t & out)
+        {
+            uint64_t total = reader->count();
+            if (pos >= total) return false;
+            size_t n = (size_t) (std::min)((uint64_t) chunk, total - pos);
+            size_t channels = reader->channels();
+            uint64_t frame_size = reader->_frame_size();
+            uint64_t begin = reader->h.header_size + pos * frame_size;
+            uint64_t end = begin + n * frame_size;
+            if (!_slide(begin, end)) return false;
+            char * at = window_base + window_offset + (size_t) (begin - window_begin);
+            out.count = n;
+            out.period = reader->period();
+            if (reader->dtype() == capture_float64)
+            {
+                double * p = (double *) at + channel;
+                if (channels == 1)
+                {
+                    out.samples = p;
+                }
+                else
+                {
+                    buffer.resize(n);
+                    for (size_t i = 0; i < n; ++i) buffer[i] = p[i * channels];
+                    out.samples = buffer.data();
+                }
+            }
+            else
+            {
+                const float * p = (const float *) at + channel;
+                buffer.resize(n);
+                for (size_t i = 0; i < n; ++i) buffer[i] = p[i * channels];
+                out.samples = buffer.data();
+            }
+            pos += n;
+            return true;
+        }
+
+    private:
+
+        capture_cursor(const capture_cursor &);
+        capture_cursor & operator = (const capture_cursor &);
+
+        /* ensures `[begin, end)` is mapped */
+        bool _slide(uint64_t begin, uint64_t end)
+        {
+            if ((window_base != nullptr) && (begin >= window_begin) && (end <= window_end)) return true;
+            _release();
+            uint64_t length = (std::max)(end - begin,
+                                         (std::min)((uint64_t) window_size, reader->size - begin));
+            window_base = reader->_map(begin, (size_t) length, window_offset);
+            if (window_base == nullptr) return false;
+            window_length = window_offset + (size_t) length;
+            window_begin = begin;
+            window_end = begin + length;
+            return true;
+        }
+
+        void _release()
+        {
+            if (window_base != nullptr) capture_reader::_unmap(window_base, window_length);
+            window_base = nullptr;
+        }
+    };
+
+    inline capture_cursor capture_reader::chunks(size_t frames, size_t channel) const
+    {
+        return capture_cursor(*this, frames, channel);
+    }
+}
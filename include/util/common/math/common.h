@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <algorithm>
 #include <functional>
 #include <cassert>
 
@@ -26,6 +32,15 @@ namespace math
     using bi_op_t      = std::function < double(size_t, double, double) > ;
     using un_op_t      = std::function < double(size_t, double) > ;
 
+    /* row-major 2D signal, e.g. a spectrogram: `rows` rows of
+       `cols` samples; `grid_row` views a row as `sampled_t` */
+    using sampled_grid_t = struct
+    {
+        double *samples;
+        size_t rows, cols;
+        double row_period, col_period;
+    };
+
     using gaussian_t = struct
     {
         double a, s, t0;
@@ -42,24 +57,44 @@ namespace math
 
 
 
-    inline bi_op_t identity_op()
+    /* the operators are plain function objects, so that
+       the templated `map` and `combine` overloads inline
+       them; they still convert to `bi_op_t` / `un_op_t` */
+
+    struct identity_op_t
     {
-        return [] (size_t, double, double s) { return s; };
-    }
+        double operator () (size_t, double, double s) const { return s; }
+    };
+    struct identity_un_op_t
+    {
+        double operator () (size_t, double s) const { return s; }
+    };
+    struct add_op_t
+    {
+        double operator () (size_t, double d, double s) const { return d + s; }
+    };
+    struct mult_add_op_t
+    {
+        double factor;
+        double operator () (size_t, double d, double s) const { return d + s * factor; }
+    };
 
-    inline un_op_t identity_un_op()
+    inline identity_op_t identity_op()
     {
-        return [] (size_t, double s) { return s; };
+        return identity_op_t();
     }
-
-    inline bi_op_t add_op()
+    inline identity_un_op_t identity_un_op()
     {
-        return [] (size_t, double d, double s) { return d + s; };
+        return identity_un_op_t();
     }
-
-    inline bi_op_t mult_add_op(double factor)
+    inline add_op_t add_op()
     {
-        return [factor] (size_t, double d, double s) { return d + s * factor; };
+        return add_op_t();
+    }
+    inline mult_add_op_t mult_add_op(double factor)
+    {
+        mult_add_op_t op = { factor };
+        return op;
     }
 
 
@@ -105,7 +140,8 @@ namespace math
     /**
      * Combines `n` functions together using the given `combiner`
      */
-    inline continuous_t combine(size_t n, continuous_t *funcs, bi_op_t combiner = add_op())
+    template < typename _combiner_t >
+    inline continuous_t combine(size_t n, continuous_t *funcs, _combiner_t combiner)
     {
         return [=] (double t)
         {
@@ -118,6 +154,14 @@ namespace math
             return result;
         };
     }
+    inline continuous_t combine(size_t n, continuous_t *funcs, bi_op_t combiner)
+    {
+        return combine < bi_op_t > (n, funcs, combiner);
+    }
+    inline continuous_t combine(size_t n, continuous_t *funcs)
+    {
+        return combine(n, funcs, add_op());
+    }
 
 
 
@@ -129,9 +173,10 @@ namespace math
     /**
      * Returns the signal power.
      */
-    inline double sample(continuous_t &continuous,
-                         sampled_t    &sampled,
-                         size_t       samples = 0)
+    template < typename _continuous_t >
+    inline double sample(_continuous_t &continuous,
+                         sampled_t     &sampled,
+                         size_t        samples = 0)
     {
         if (samples == 0) samples = sampled.count;
         assert(samples <= sampled.count);
@@ -144,6 +189,12 @@ namespace math
         }
         return power;
     }
+    inline double sample(continuous_t &continuous,
+                         sampled_t    &sampled,
+                         size_t       samples = 0)
+    {
+        return sample < continuous_t > (continuous, sampled, samples);
+    }
 
     inline sampled_t allocate_sampled(size_t size, size_t count, double period)
     {
@@ -159,6 +210,12 @@ namespace math
     {
         delete[] sampled.samples;
     }
+    inline sampled_t grid_row(const sampled_grid_t &grid, size_t row)
+    {
+        assert(row < grid.rows);
+        sampled_t s = { grid.samples + row * grid.cols, grid.cols, grid.col_period };
+        return s;
+    }
 
 
 
@@ -168,26 +225,55 @@ namespace math
 
 
 
-    inline void map(sampled_t &dest,
+    /* the templated overloads accept arbitrary callables
+       and are inlined into the loop; the `std::function`
+       ones are kept for compatibility; the return types
+       restrict them to `op(i, d[, s])` callables, so that
+       `map(a, b)` on the types converting to `sampled_t &`
+       (e.g. `sampled_buffer`) still picks the identity one */
+
+    template < typename _bi_op_t >
+    inline auto map(sampled_t &dest,
                     sampled_t &source,
-                    bi_op_t   op = identity_op())
+                    _bi_op_t  op)
+        -> decltype(op(size_t(), double(), double()), void())
     {
         assert(dest.count == source.count);
         assert(abs(dest.period - source.period) < 1e-15);
+        double * d = dest.samples;
+        const double * s = source.samples;
         for (size_t i = 0; i < dest.count; i++)
         {
-            dest.samples[i] = op(i, dest.samples[i], source.samples[i]);
+            d[i] = op(i, d[i], s[i]);
         }
     }
-
     inline void map(sampled_t &dest,
-                    un_op_t   op)
+                    sampled_t &source,
+                    bi_op_t   op)
     {
+        map < bi_op_t > (dest, source, op);
+    }
+    inline void map(sampled_t &dest,
+                    sampled_t &source)
+    {
+        map(dest, source, identity_op());
+    }
+    template < typename _un_op_t >
+    inline auto map(sampled_t &dest,
+                    _un_op_t  op)
+        -> decltype(op(size_t(), double()), void())
+    {
+        double * d = dest.samples;
         for (size_t i = 0; i < dest.count; i++)
         {
-            dest.samples[i] = op(i, dest.samples[i]);
+            d[i] = op(i, d[i]);
         }
     }
+    inline void map(sampled_t &dest,
+                    un_op_t   op)
+    {
+        map < un_op_t > (dest, op);
+    }
 
 
 
@@ -232,14 +318,25 @@ namespace math
         assert(abs(input1.period - input2.period) < 1e-15);
         assert(abs(input1.period - output.period) < 1e-15);
         size_t n = input1.count, m = output.count;
-        double max = (std::numeric_limits<double>::min)(); size_t max_idx = 0;
+        double max = (std::numeric_limits<double>::lowest)(); size_t max_idx = 0;
         for (size_t k = 0; k < m; k++)
         {
             output.samples[k] = 0;
-            for (size_t i = 0; i < n; i++)
+            /* the index `(idx + k) % n` wraps once over the sum,
+               so the sum is split into two modulo-free ranges */
+            if (reflect)
+            {
+                for (size_t i = 0; i < k; i++)
+                    output.samples[k] += input1.samples[i] * input2.samples[k - 1 - i];
+                for (size_t i = k; i < n; i++)
+                    output.samples[k] += input1.samples[i] * input2.samples[n - 1 - i + k];
+            }
+            else
             {
-                size_t idx = (reflect ? (n - i - 1) : i);
-                output.samples[k] += input1.samples[i] * input2.samples[(idx + k) % n];
+                for (size_t i = 0; i < n - k; i++)
+                    output.samples[k] += input1.samples[i] * input2.samples[i + k];
+                for (size_t i = n - k; i < n; i++)
+                    output.samples[k] += input1.samples[i] * input2.samples[i + k - n];
             }
             output.samples[k] /= (n);
             if (output.samples[k] > max)
@@ -314,22 +411,79 @@ namespace math
 
 
 
-    inline void sort_all(double **arrays, size_t n_arrays, size_t n_elements, int order = 1 /* lower */)
+    /* the key and the original position of an element;
+       sorting the pairs keeps the comparisons in cache */
+    using _sort_entry_t = std::pair < double, size_t > ;
+
+    /* NaN keys compare equal to each other and after any
+       number in both orders, so the comparators stay strict
+       weak orderings */
+
+    inline bool _sort_ascending(const _sort_entry_t &a, const _sort_entry_t &b)
+    {
+        return (a.first < b.first) || (std::isnan(b.first) && !std::isnan(a.first));
+    }
+
+    inline bool _sort_descending(const _sort_entry_t &a, const _sort_entry_t &b)
+    {
+        return (a.first > b.first) || (std::isnan(b.first) && !std::isnan(a.first));
+    }
+
+    template < typename _iterator_t >
+    inline void _sort_entries(_iterator_t first, _iterator_t last, int order, bool stable)
+    {
+        auto less = (order > 0) ? &_sort_ascending : &_sort_descending;
+        if (stable) std::stable_sort(first, last, less);
+        else        std::sort(first, last, less);
+    }
+
+    /* buffer[i] = arrays[k][entries[i].second], i in [from, to) */
+    inline void _gather_sorted(double **arrays, size_t k,
+                               const std::vector < _sort_entry_t > &entries,
+                               size_t from, size_t to,
+                               double *buffer)
+    {
+        const double *source = arrays[k];
+        for (size_t i = from; i < to; i++)
+        {
+            buffer[i] = source[entries[i].second];
+        }
+    }
+
+    /**
+     * Sorts `arrays[0]` and reorders all the other
+     * arrays the same way.
+     *
+     * One sort permutation is computed on the keys, then
+     * every array is rearranged in a single gather pass,
+     * O(n log n + n k) in total.
+     *
+     * NaN keys are placed after all the others in both
+     * orders.
+     *
+     * Parameters:
+     *      order  - positive for ascending, negative for
+     *               descending; 0 leaves the arrays as is
+     *      stable - keep the relative order of equal keys
+     */
+    inline void sort_all(double **arrays, size_t n_arrays, size_t n_elements,
+                         int order = 1 /* lower */, bool stable = false)
     {
         assert(n_arrays > 0);
-        double *keys = arrays[0];
+        if (order == 0) return;
+        std::vector < _sort_entry_t > entries(n_elements);
         for (size_t i = 0; i < n_elements; i++)
         {
-            for (size_t j = i + 1; j < n_elements; j++)
-            {
-                if (order * (keys[i] - keys[j]) > 0)
-                {
-                    for (size_t k = 0; k < n_arrays; k++)
-                    {
-                        std::swap(arrays[k][i], arrays[k][j]);
-                    }
-                }
-            }
+            entries[i] = _sort_entry_t(arrays[0][i], i);
+        }
+        _sort_entries(entries.begin(), entries.end(), order, stable);
+
+        for (size_t i = 0; i < n_elements; i++) arrays[0][i] = entries[i].first;
+        std::vector < double > buffer(n_elements);
+        for (size_t k = 1; k < n_arrays; k++)
+        {
+            _gather_sorted(arrays, k, entries, 0, n_elements, buffer.data());
+            std::copy(buffer.begin(), buffer.end(), arrays[k]);
         }
     }
 }
@@ -0,0 +1,433 @@
+#pragma once
+
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/ptr.h>
+#include <util/common/math/common.h>
+#include <util/common/math/fft.h>
+
+namespace math
+{
+
+    enum convolution_mode
+    {
+        cyclic_convolution,
+        linear_convolution
+    };
+
+    /**
+     * The smallest even `2^a * 3^b * 5^c >= n`, i.e. the smallest
+     * length suitable for the real mixed-radix transform.
+     */
+    inline size_t fft_fast_size(size_t n)
+    {
+        size_t best = 2;
+        while (best < n) best <<= 1;
+        for (size_t p5 = 2; p5 < best; p5 *= 5)
+        for (size_t p35 = p5; p35 < best; p35 *= 3)
+        {
+            size_t s = p35;
+            while (s < n) s <<= 1;
+            if (s < best) best = s;
+        }
+        return best;
+    }
+
+    /* pointwise product of the half spectra */
+    inline void _multiply_spectra(complex < > * a, const complex < > * b, size_t count)
+    {
+        for (size_t k = 0; k < count; ++k) a[k] = _fft_mul(b[k], a[k]);
+    }
+
+    /*****************************************************/
+    /*                  ola_convolver                    */
+    /*****************************************************/
+
+    /**
+     * Streaming linear convolution with a fixed (short) kernel
+     * by the overlap-add method: the input is split into blocks
+     * that are convolved via the real FFT of the length
+     * `block_size() + kernel_size() - 1` rounded up to a fast
+     * length, the overlapping tails are carried over to the
+     * next block.
+     *
+     * `process` emits as many output samples as it consumes
+     * input samples, `flush` emits the remaining
+     * `kernel_size() - 1` samples and resets the state.
+     *
+     * The kernel spectrum, plans and buffers are allocated
+     * in the constructor only.
+     */
+    class ola_convolver
+    {
+
+    private:
+
+        size_t m, l, nfft;
+
+        rfft_plan forward, inverse;
+
+        std::vector < complex < > > kernel, spectrum, scratch;
+        std::vector < double > block, tail;
+
+    public:
+
+        /**
+         * `block` - the number of input samples per transform;
+         *           0 selects the cheapest one per output sample
+         */
+        ola_convolver(const double * kernel_samples, size_t kernel_size, size_t block = 0)
+            : m(kernel_size)
+            , l(block)
+            , nfft(_fft_size(kernel_size, block))
+            , forward(nfft, -1)
+            , inverse(nfft, 1)
+        {
+            assert(m > 0);
+
+            l = nfft - m + 1;
+
+            kernel.resize(forward.spectrum_size());
+            spectrum.resize(forward.spectrum_size());
+            scratch.resize(forward.scratch_size());
+            this->block.assign(nfft, 0);
+            tail.assign(m - 1, 0);
+
+            std::copy(kernel_samples, kernel_samples + m, this->block.begin());
+            forward.execute(this->block.data(), kernel.data(), scratch.data());
+        }
+
+        size_t kernel_size() const { return m; }
+
+        size_t block_size() const { return l; }
+
+        void process(const double * input, size_t count, double * output)
+        {
+            while (count > 0)
+            {
+                size_t c = (std::min)(count, l);
+
+                std::copy(input, input + c, block.begin());
+                std::fill(block.begin() + c, block.end(), 0.);
+
+                forward.execute(block.data(), spectrum.data(), scratch.data());
+                _multiply_spectra(spectrum.data(), kernel.data(), spectrum.size());
+                inverse.execute(spectrum.data(), block.data(), scratch.data());
+
+                for (size_t t = 0; t < c; ++t)
+                {
+                    output[t] = block[t] + ((t < m - 1) ? tail[t] : 0.);
+                }
+                for (size_t t = 0; t < m - 1; ++t)
+                {
+                    tail[t] = block[c + t] + ((c + t < m - 1) ? tail[c + t] : 0.);
+                }
+
+                input += c; output += c; count -= c;
+            }
+        }
+
+        void flush(double * output)
+        {
+            std::copy(tail.begin(), tail.end(), output);
+            reset();
+        }
+
+        void reset()
+        {
+            std::fill(tail.begin(), tail.end(), 0.);
+        }
+
+    private:
+
+        /* minimizes `N log N / (N - m + 1)` over power-of-two `N`
+           unless the block size is given explicitly */
+        static size_t _fft_size(size_t m, size_t block)
+        {
+            if (block > 0) return fft_fast_size(block + m - 1);
+            size_t best = 0; double best_cost = 0;
+            size_t n = 2;
+            while (n < 2 * m) n <<= 1;
+            for (size_t i = 0; i < 6; ++i, n <<= 1)
+            {
+                double cost = n * std::log((double) n) / (n - m + 1);
+                if ((best == 0) || (cost < best_cost)) { best = n; best_cost = cost; }
+            }
+            return (std::max)(best, (size_t) 64);
+        }
+    };
+
+    /*****************************************************/
+    /*                  fast convolution                 */
+    /*****************************************************/
+
+    /**
+     * Estimates whether the FFT-based convolution of `n`-
+     * and `m`-sample signals is cheaper than the direct one,
+     * the transforms being `nfft`-point ones over `work`
+     * points in total per pass (`n_out` unless the transform
+     * is computed via a longer one).
+     *
+     * The cost is counted in multiply-adds, the constants are
+     * fitted to `fft_bench::_convolution_direct_vs_fft`.
+     */
+    inline bool _prefer_fft_convolution(size_t n, size_t m, size_t work, size_t nfft)
+    {
+        if ((std::min)(n, m) <= 8) return false;
+        double direct = (double) n * m;
+        double fft = 3. * work * std::log((double) nfft) / std::log(2.) + 6000.;
+        return fft < direct;
+    }
+
+    /* `n = 2^a 3^b 5^c`, transformed by `fft_plan` directly;
+       the other lengths go through Bluestein, i.e. about
+       three transforms of `fft_fast_size(2 n)` points */
+    inline bool _is_fft_fast_size(size_t n)
+    {
+        if (n == 0) return false;
+        static const size_t radices[] = { 2, 3, 5 };
+        for (size_t r = 0; r < 3; ++r)
+        {
+            while (n % radices[r] == 0) n /= radices[r];
+        }
+        return n == 1;
+    }
+
+    /*****************************************************/
+    /*               convolution plan cache              */
+    /*****************************************************/
+
+    /**
+     * The forward and inverse plans of `n`-point convolution
+     * transforms: the real ones for even `n`, the complex
+     * ones for odd `n`. Immutable once built, so the threads
+     * share them and only the scratch is per call.
+     */
+    struct _convolution_plans
+    {
+        size_t n;
+        util::ptr_t < rfft_plan > rforward, rinverse;
+        util::ptr_t < fft_plan > forward, inverse;
+
+        explicit _convolution_plans(size_t n)
+            : n(n)
+        {
+            if (n % 2 == 0)
+            {
+                rforward = util::create < rfft_plan > (n, -1);
+                rinverse = util::create < rfft_plan > (n, 1);
+            }
+            else
+            {
+                forward = util::create < fft_plan > (n, -1);
+                inverse = util::create < fft_plan > (n, 1);
+            }
+        }
+    };
+
+    /* the number of transform sizes kept by the cache */
+    inline size_t convolution_plan_cache_size()
+    {
+        return 8;
+    }
+
+    template < typename _dummy_t = void >
+    struct _convolution_plan_cache
+    {
+        static std::mutex mutex;
+        /* the most recently used last */
+        static std::vector < util::ptr_t < const _convolution_plans > > plans;
+    };
+
+    template < typename _dummy_t >
+    std::mutex _convolution_plan_cache < _dummy_t > ::mutex;
+
+    template < typename _dummy_t >
+    std::vector < util::ptr_t < const _convolution_plans > > _convolution_plan_cache < _dummy_t > ::plans;
+
+    /**
+     * The plans of `n`-point transforms from the process-wide
+     * cache of the `convolution_plan_cache_size()` most
+     * recently used sizes; thread-safe, the plans are built
+     * outside the lock.
+     */
+    inline util::ptr_t < const _convolution_plans > _get_convolution_plans(size_t n)
+    {
+        typedef _convolution_plan_cache < > cache;
+        {
+            std::lock_guard < std::mutex > lock(cache::mutex);
+            for (size_t i = 0; i < cache::plans.size(); ++i)
+            {
+                if (cache::plans[i]->n != n) continue;
+                util::ptr_t < const _convolution_plans > p = cache::plans[i];
+                cache::plans.erase(cache::plans.begin() + i);
+                cache::plans.push_back(p);
+                return p;
+            }
+        }
+        util::ptr_t < const _convolution_plans > p = util::create < _convolution_plans > (n);
+        std::lock_guard < std::mutex > lock(cache::mutex);
+        cache::plans.push_back(p);
+        if (cache::plans.size() > convolution_plan_cache_size())
+        {
+            cache::plans.erase(cache::plans.begin());
+        }
+        return p;
+    }
+
+    inline void _convolve_linear_direct(const double * f, size_t n,
+                                        const double * g, size_t m,
+                                        double * output)
+    {
+        for (size_t i = 0; i < n + m - 1; ++i)
+        {
+            size_t j0 = (i >= m - 1) ? (i - (m - 1)) : 0;
+            size_t j1 = (std::min)(i, n - 1);
+            double s = 0;
+            for (size_t j = j0; j <= j1; ++j) s += f[j] * g[i - j];
+            output[i] = s;
+        }
+    }
+
+    /* cyclic convolution of two `n`-sample signals via
+       the real (even `n`) or the complex (odd `n`) FFT */
+    inline void _convolve_cyclic_fft(const double * f, const double * g,
+                                     size_t n, double * output)
+    {
+        util::ptr_t < const _convolution_plans > plans = _get_convolution_plans(n);
+        if (n % 2 == 0)
+        {
+            const rfft_plan & forward = *plans->rforward, & inverse = *plans->rinverse;
+            std::vector < complex < > > a(forward.spectrum_size()), b(a.size());
+            std::vector < complex < > > scratch(forward.scratch_size());
+            forward.execute(f, a.data(), scratch.data());
+            forward.execute(g, b.data(), scratch.data());
+            _multiply_spectra(a.data(), b.data(), a.size());
+            inverse.execute(a.data(), output, scratch.data());
+        }
+        else
+        {
+            const fft_plan & forward = *plans->forward, & inverse = *plans->inverse;
+            std::vector < complex < > > a(n), scratch(forward.scratch_size());
+            for (size_t i = 0; i < n; ++i) a[i] = { f[i], g[i] };
+            forward.execute(a.data(), scratch.data());
+            /* unpack the spectra of two real signals
+               transformed at once and multiply them */
+            std::vector < complex < > > c(n);
+            for (size_t k = 0; k < n; ++k)
+            {
+                complex < > z1 = a[k], z2 = conjugate(a[(n - k) % n]);
+                complex < > fk = (z1 + z2) * 0.5;
+                complex < > gk = (z1 - z2) * 0.5;
+                gk = { gk.im, - gk.re };
+                c[k] = _fft_mul(fk, gk);
+            }
+            inverse.execute(c.data(), scratch.data());
+            for (size_t i = 0; i < n; ++i) output[i] = c[i].re;
+        }
+    }
+
+    inline void _convolve_linear_fft(const double * f, size_t n,
+                                     const double * g, size_t m,
+                                     double * output)
+    {
+        /* overlap-add pays off when one of the signals is short */
+        if (m > n) { std::swap(f, g); std::swap(n, m); }
+        if (m * 8 <= n)
+        {
+            ola_convolver ola(g, m);
+            ola.process(f, n, output);
+            ola.flush(output + n);
+            return;
+        }
+
+        size_t len = n + m - 1, nfft = fft_fast_size(len);
+        util::ptr_t < const _convolution_plans > plans = _get_convolution_plans(nfft);
+        const rfft_plan & forward = *plans->rforward, & inverse = *plans->rinverse;
+        std::vector < double > buf(nfft, 0.);
+        std::vector < complex < > > a(forward.spectrum_size()), b(a.size());
+        std::vector < complex < > > scratch(forward.scratch_size());
+
+        std::copy(f, f + n, buf.begin());
+        forward.execute(buf.data(), a.data(), scratch.data());
+        std::fill(buf.begin(), buf.end(), 0.);
+        std::copy(g, g + m, buf.begin());
+        forward.execute(buf.data(), b.data(), scratch.data());
+        _multiply_spectra(a.data(), b.data(), a.size());
+        inverse.execute(a.data(), buf.data(), scratch.data());
+        std::copy(buf.begin(), buf.begin() + len, output);
+    }
+
+    /**
+     * Calculates convolution of `f` and `g`, selecting the
+     * direct or the FFT-based algorithm by the signal sizes.
+     *
+     * Modes:
+     *      cyclic_convolution - same as `convolve(f, g, output)`:
+     *                           `f.count == g.count` samples
+     *      linear_convolution - zero-padded convolution:
+     *                           `f.count + g.count - 1` samples,
+     *                           long signals with short kernels
+     *                           are processed by overlap-add
+     *
+     * Returns:
+     *      The power of the convolution signal
+     */
+    inline double convolve(sampled_t &f,
+                           sampled_t &g,
+                           sampled_t &output,
+                           convolution_mode mode,
+                           un_op_t mapper = identity_un_op())
+    {
+        assert(abs(f.period - g.period) < 1e-15);
+        assert(abs(f.period - output.period) < 1e-15);
+
+        size_t n = f.count, m = g.count, n_out;
+
+        if (mode == cyclic_convolution)
+        {
+            assert(n == m);
+            assert(n <= output.count);
+            n_out = n;
+            size_t work = n, nfft = n;
+            if (!_is_fft_fast_size(n))
+            {
+                nfft = fft_fast_size(2 * n);
+                work = 3 * nfft;
+            }
+            if (!_prefer_fft_convolution(n, m, work, nfft))
+            {
+                return convolve(f, g, output, mapper);
+            }
+            _convolve_cyclic_fft(f.samples, g.samples, n, output.samples);
+        }
+        else
+        {
+            assert((n > 0) && (m > 0));
+            n_out = n + m - 1;
+            assert(n_out <= output.count);
+            size_t k = (std::min)(n, m);
+            size_t nfft = (k * 8 <= (std::max)(n, m)) ? 8 * k : fft_fast_size(n_out);
+            if (_prefer_fft_convolution(n, m, n_out, nfft))
+            {
+                _convolve_linear_fft(f.samples, n, g.samples, m, output.samples);
+            }
+            else
+            {
+                _convolve_linear_direct(f.samples, n, g.samples, m, output.samples);
+            }
+        }
+
+        double power = 0;
+        for (size_t i = 0; i < n_out; ++i)
+        {
+            output.samples[i] = mapper(i, output.samples[i]);
+            power += output.samples[i] * output.samples[i];
+        }
+        return power;
+    }
+}
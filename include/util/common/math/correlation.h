@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <utility>
+#include <algorithm>
+
+#include <util/common/math/common.h>
+#include <util/common/math/fft.h>
+#include <util/common/math/convolution.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*         Wiener-Khinchin correlation               */
+    /*****************************************************/
+
+    /**
+     * Calculates the autocorrelation sequence of `input`
+     * via the power spectrum; same result as
+     * `autocorrelation(input, output)` in O(n log n).
+     */
+    inline void fast_autocorrelation(sampled_t &input,
+                                     sampled_t &output)
+    {
+        assert(input.count > output.count);
+        assert(abs(input.period - output.period) < 1e-15);
+        size_t n = input.count, m = output.count;
+        if (m == 0) return;
+
+        /* zero padding to `n + m - 1` prevents the lags
+           of interest from wrapping around */
+        size_t nfft = fft_fast_size(n + m - 1);
+        rfft_plan forward(nfft, -1), inverse(nfft, 1);
+        std::vector < double > buf(nfft, 0.);
+        std::vector < complex < > > spectrum(forward.spectrum_size());
+        std::vector < complex < > > scratch(forward.scratch_size());
+
+        std::copy(input.samples, input.samples + n, buf.begin());
+        forward.execute(buf.data(), spectrum.data(), scratch.data());
+        for (size_t k = 0; k < spectrum.size(); ++k)
+        {
+            spectrum[k] = { sqnorm(spectrum[k]), 0 };
+        }
+        inverse.execute(spectrum.data(), buf.data(), scratch.data());
+
+        for (size_t k = 0; k < m; k++)
+        {
+            output.samples[k] = buf[k] / (n - k);
+        }
+    }
+
+    /**
+     * Calculates the cyclic correlation sequence of `input1`
+     * and `input2`; same result as `correlation(...)`
+     * in O(n log n).
+     *
+     * Parameters:
+     *      reflect - reflect `input2` sequence
+     */
+    inline std::pair < size_t, double > fast_correlation(
+        sampled_t &input1,
+        sampled_t &input2,
+        sampled_t &output,
+        bool reflect = false)
+    {
+        assert(input1.count == input2.count);
+        assert(input1.count >= output.count);
+        assert(abs(input1.period - input2.period) < 1e-15);
+        assert(abs(input1.period - output.period) < 1e-15);
+        size_t n = input1.count, m = output.count;
+
+        std::vector < double > a(n), c(n);
+        if (reflect)
+        {
+            /* sum_i x1[i] x2[n - 1 - i + k] = (x1 * x2)[k + n - 1] */
+            std::copy(input1.samples, input1.samples + n, a.begin());
+        }
+        else
+        {
+            /* sum_i x1[i] x2[i + k] = (x1[-i] * x2)[k] */
+            for (size_t i = 0; i < n; ++i) a[i] = input1.samples[(n - i) % n];
+        }
+        _convolve_cyclic_fft(a.data(), input2.samples, n, c.data());
+
+        double max = (std::numeric_limits < double > ::lowest)(); size_t max_idx = 0;
+        for (size_t k = 0; k < m; k++)
+        {
+            output.samples[k] = c[reflect ? ((k + n - 1) % n) : k] / n;
+            if (output.samples[k] > max)
+            {
+                max = output.samples[k];
+                max_idx = k;
+            }
+        }
+        return { max_idx, max };
+    }
+
+    /**
+     * Calculates the full-lag (linear, non-normalized)
+     * cross-correlation of `input1` and `input2`:
+     *
+     *      output[k + n1 - 1] = sum_i x1[i] x2[i + k],
+     *      k = -(n1 - 1) .. (n2 - 1)
+     *
+     * `output` must hold `n1 + n2 - 1` samples; use
+     * `lag_origin(input1)` as the `origin` of `top_lags`.
+     *
+     * Parameters:
+     *      reflect - reflect `input2` sequence, i.e. the
+     *                linear convolution of the inputs
+     */
+    inline void cross_correlation(sampled_t &input1,
+                                  sampled_t &input2,
+                                  sampled_t &output,
+                                  bool reflect = false)
+    {
+        assert(abs(input1.period - input2.period) < 1e-15);
+        assert(abs(input1.period - output.period) < 1e-15);
+        size_t n1 = input1.count, n2 = input2.count;
+        assert((n1 > 0) && (n2 > 0));
+        assert(n1 + n2 - 1 <= output.count);
+
+        if (reflect)
+        {
+            _convolve_linear_fft(input1.samples, n1, input2.samples, n2, output.samples);
+            return;
+        }
+        std::vector < double > a(input1.samples, input1.samples + n1);
+        std::reverse(a.begin(), a.end());
+        _convolve_linear_fft(a.data(), n1, input2.samples, n2, output.samples);
+    }
+
+    /**
+     * The index of the zero lag in the `cross_correlation` output.
+     */
+    inline ptrdiff_t lag_origin(const sampled_t &input1)
+    {
+        return (ptrdiff_t) input1.count - 1;
+    }
+
+    /*****************************************************/
+    /*                  peak search                      */
+    /*****************************************************/
+
+    struct lag_peak
+    {
+        /* sub-sample lag, relative to the origin */
+        double lag;
+        /* interpolated peak value */
+        double value;
+        /* index of the sample the peak was found at */
+        size_t index;
+    };
+
+    /**
+     * Parabolic interpolation of the peak at `y0` with
+     * neighbours `ym` and `yp`.
+     *
+     * Returns:
+     *      The offset in (-0.5, 0.5) and the peak value
+     */
+    inline std::pair < double, double > parabolic_peak(double ym, double y0, double yp)
+    {
+        double d = ym - 2 * y0 + yp;
+        if (d >= 0) return { 0., y0 };
+        double delta = 0.5 * (ym - yp) / d;
+        return { delta, y0 - 0.25 * (ym - yp) * delta };
+    }
+
+    /**
+     * Finds `k` greatest local maxima of the correlation
+     * sequence `seq` and refines their positions with
+     * the parabolic interpolation.
+     *
+     * Parameters:
+     *      cyclic - the sequence wraps around (`correlation`
+     *               output); boundary samples are compared
+     *               to the single neighbour otherwise
+     *      origin - the index of the zero lag
+     *
+     * Returns:
+     *      Peaks ordered by the value, descending
+     */
+    inline std::vector < lag_peak > top_lags(const sampled_t &seq,
+                                             size_t k,
+                                             bool cyclic = false,
+                                             ptrdiff_t origin = 0)
+    {
+        std::vector < lag_peak > peaks;
+        size_t n = seq.count;
+        const double * y = seq.samples;
+        if ((n == 0) || (k == 0)) return peaks;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            bool wrap = cyclic && (n > 1);
+            bool has_prev = wrap || (i > 0), has_next = wrap || (i + 1 < n);
+            double ym = has_prev ? y[(i + n - 1) % n] : y[i];
+            double yp = has_next ? y[(i + 1) % n] : y[i];
+            /* plateaus report their first sample only */
+            if ((y[i] <= ym && has_prev) || (y[i] < yp)) continue;
+
+            std::pair < double, double > p = (has_prev && has_next) ?
+                parabolic_peak(ym, y[i], yp) : std::make_pair(0., y[i]);
+            lag_peak peak = { (double) ((ptrdiff_t) i - origin) + p.first, p.second, i };
+            peaks.push_back(peak);
+        }
+
+        auto by_value = [] (const lag_peak & a, const lag_peak & b) { return a.value > b.value; };
+        k = (std::min)(k, peaks.size());
+        std::partial_sort(peaks.begin(), peaks.begin() + k, peaks.end(), by_value);
+        peaks.resize(k);
+        return peaks;
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/math/common.h>
+
+namespace math
+{
+
+    /**
+     * Expression templates over sampled signals.
+     *
+     * Arithmetic on `val(...)` terminals, scalars and
+     * `apply(op, ...)` nodes builds a lazy expression tree;
+     * `assign(dest, e)` evaluates the whole tree in a single
+     * pass with every operator inlined, e.g.
+     *
+     *      // map(dest, src, mult_add_op(k)) + scaling, one pass
+     *      assign(dest, apply(mult_add_op(k), val(dest), val(src)) * scale);
+     *
+     * Operators take the same `(index, value[, value])`
+     * arguments as `bi_op_t` / `un_op_t`. Element-wise
+     * expressions may read the destination.
+     */
+    namespace expr
+    {
+
+        template < typename _expr_t >
+        struct expression
+        {
+            const _expr_t & self() const { return static_cast < const _expr_t & > (*this); }
+        };
+
+        /* the number of samples of an operand; 0 for scalars */
+        inline size_t _common_size(size_t a, size_t b)
+        {
+            assert((a == 0) || (b == 0) || (a == b));
+            return (std::max)(a, b);
+        }
+
+        /*****************************************************/
+        /*                    terminals                      */
+        /*****************************************************/
+
+        struct samples_expr : expression < samples_expr >
+        {
+            const double * samples;
+            size_t count;
+
+            samples_expr(const double * samples, size_t count)
+                : samples(samples), count(count) { }
+
+            double operator () (size_t i) const { return samples[i]; }
+            size_t size() const { return count; }
+        };
+
+        struct scalar_expr : expression < scalar_expr >
+        {
+            double value;
+
+            explicit scalar_expr(double value)
+                : value(value) { }
+
+            double operator () (size_t) const { return value; }
+            size_t size() const { return 0; }
+        };
+
+        inline samples_expr val(const sampled_t &s)
+        {
+            return samples_expr(s.samples, s.count);
+        }
+
+        /*****************************************************/
+        /*                      nodes                        */
+        /*****************************************************/
+
+        template < typename _op_t, typename _arg_t >
+        struct unary_expr : expression < unary_expr < _op_t, _arg_t > >
+        {
+            _op_t op;
+            _arg_t arg;
+
+            unary_expr(const _op_t & op, const _arg_t & arg)
+                : op(op), arg(arg) { }
+
+            double operator () (size_t i) const { return op(i, arg(i)); }
+            size_t size() const { return arg.size(); }
+        };
+
+        template < typename _op_t, typename _left_t, typename _right_t >
+        struct binary_expr : expression < binary_expr < _op_t, _left_t, _right_t > >
+        {
+            _op_t op;
+            _left_t left;
+            _right_t right;
+
+            binary_expr(const _op_t & op, const _left_t & left, const _right_t & right)
+                : op(op), left(left), right(right) { }
+
+            double operator () (size_t i) const { return op(i, left(i), right(i)); }
+            size_t size() const { return _common_size(left.size(), right.size()); }
+        };
+
+        /**
+         * Applies an arbitrary `(index, value)` operator.
+         */
+        template < typename _op_t, typename _arg_t >
+        inline unary_expr < _op_t, _arg_t >
+        apply(_op_t op, const expression < _arg_t > &arg)
+        {
+            return unary_expr < _op_t, _arg_t > (op, arg.self());
+        }
+
+        /**
+         * Applies an arbitrary `(index, value, value)` operator,
+         * e.g. the `bi_op_t` factories of `common.h`.
+         */
+        template < typename _op_t, typename _left_t, typename _right_t >
+        inline binary_expr < _op_t, _left_t, _right_t >
+        apply(_op_t op, const expression < _left_t > &left, const expression < _right_t > &right)
+        {
+            return binary_expr < _op_t, _left_t, _right_t > (op, left.self(), right.self());
+        }
+
+        /*****************************************************/
+        /*                    arithmetic                     */
+        /*****************************************************/
+
+        struct _negate_op
+        {
+            double operator () (size_t, double a) const { return - a; }
+        };
+        struct _minus_op
+        {
+            double operator () (size_t, double a, double b) const { return a - b; }
+        };
+        struct _times_op
+        {
+            double operator () (size_t, double a, double b) const { return a * b; }
+        };
+        struct _divides_op
+        {
+            double operator () (size_t, double a, double b) const { return a / b; }
+        };
+
+        template < typename _arg_t >
+        inline unary_expr < _negate_op, _arg_t >
+        operator - (const expression < _arg_t > &arg)
+        {
+            return unary_expr < _negate_op, _arg_t > (_negate_op(), arg.self());
+        }
+
+#define _UTIL_MATH_EXPR_OPERATOR(_sym, _op)                                     \
+        template < typename _left_t, typename _right_t >                        \
+        inline binary_expr < _op, _left_t, _right_t >                           \
+        operator _sym (const expression < _left_t > &left,                      \
+                       const expression < _right_t > &right)                    \
+        {                                                                       \
+            return binary_expr < _op, _left_t, _right_t >                       \
+                (_op(), left.self(), right.self());                             \
+        }                                                                       \
+        template < typename _left_t >                                           \
+        inline binary_expr < _op, _left_t, scalar_expr >                        \
+        operator _sym (const expression < _left_t > &left, double right)        \
+        {                                                                       \
+            return binary_expr < _op, _left_t, scalar_expr >                    \
+                (_op(), left.self(), scalar_expr(right));                       \
+        }                                                                       \
+        template < typename _right_t >                                          \
+        inline binary_expr < _op, scalar_expr, _right_t >                       \
+        operator _sym (double left, const expression < _right_t > &right)       \
+        {                                                                       \
+            return binary_expr < _op, scalar_expr, _right_t >                   \
+                (_op(), scalar_expr(left), right.self());                       \
+        }
+
+        _UTIL_MATH_EXPR_OPERATOR(+, add_op_t)
+        _UTIL_MATH_EXPR_OPERATOR(-, _minus_op)
+        _UTIL_MATH_EXPR_OPERATOR(*, _times_op)
+        _UTIL_MATH_EXPR_OPERATOR(/, _divides_op)
+
+#undef _UTIL_MATH_EXPR_OPERATOR
+
+        /*****************************************************/
+        /*                    evaluation                     */
+        /*****************************************************/
+
+        /**
+         * Evaluates `e` into `dest` in a single pass.
+         */
+        template < typename _expr_t >
+        inline void assign(sampled_t &dest, const expression < _expr_t > &e)
+        {
+            const _expr_t & x = e.self();
+            assert((x.size() == 0) || (x.size() == dest.count));
+            double * d = dest.samples;
+            for (size_t i = 0; i < dest.count; i++)
+            {
+                d[i] = x(i);
+            }
+        }
+    }
+}
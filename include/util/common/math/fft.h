@@ -2,14 +2,24 @@
 
 #include <math.h>
 
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/ptr.h>
+#include <util/common/thread_pool.h>
+#include <util/common/math/common.h>
 #include <util/common/math/complex.h>
+#include <util/common/math/simd.h>
 
 inline void fourier(math::complex <> * data, int n, int is)
 {
     int i, j, istep;
     int m, mmax;
     double r, r1, theta, w_r, w_i, temp_r, temp_i;
-    double pi = 3.1415926;
+    double pi = M_PI;
 
     r = pi*is;
     j = 0;
@@ -59,3 +69,1066 @@ inline void fourier(math::complex <> * data, int n, int is)
         }
 
 }
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                 radix-4 kernels                   */
+    /*****************************************************/
+
+    /* A radix-4 pass fuses two radix-2 decimation-in-time stages
+       of the half-sizes `h` and `2h`; `w1` and `w2` point to the
+       twiddles of those stages, `is` is the direction sign.
+
+       The SIMD kernels perform exactly the same IEEE operations
+       in the same order as the scalar one and never contract
+       them into FMA, so the results are bit-identical to the
+       scalar kernel. The documented budget, which also covers
+       compilers allowed to contract the scalar kernel, is
+       `log2(n)` ULP of the largest output magnitude. */
+
+    inline complex < > _fft_mul(const complex < > & w, const complex < > & z)
+    {
+        return { w.re * z.re - w.im * z.im, w.re * z.im + w.im * z.re };
+    }
+
+    inline complex < > _fft_rotate(const complex < > & z, int is)
+    {
+        return (is < 0) ? complex < > (z.im, - z.re) : complex < > (- z.im, z.re);
+    }
+
+    inline void _fft_radix4_scalar(complex < > * data, size_t n, size_t h,
+                                   const complex < > * w1, const complex < > * w2,
+                                   int is)
+    {
+        for (size_t i = 0; i < n; i += (h << 2))
+        {
+            complex < > * a = data + i;
+            complex < > * b = a + h;
+            complex < > * c = b + h;
+            complex < > * d = c + h;
+            for (size_t m = 0; m < h; ++m)
+            {
+                complex < > tb = _fft_mul(w1[m], b[m]);
+                complex < > td = _fft_mul(w1[m], d[m]);
+                complex < > a1 = a[m] + tb, b1 = a[m] - tb;
+                complex < > c1 = c[m] + td, d1 = c[m] - td;
+                complex < > tc = _fft_mul(w2[m], c1);
+                complex < > t3 = _fft_rotate(_fft_mul(w2[m], d1), is);
+                a[m] = a1 + tc;
+                b[m] = b1 + t3;
+                c[m] = a1 - tc;
+                d[m] = b1 - t3;
+            }
+        }
+    }
+
+#ifdef UTIL_SIMD_X86
+
+    UTIL_SIMD_TARGET("sse2")
+    inline __m128d _fft_mul_sse2(__m128d w, __m128d z, __m128d neg_lo)
+    {
+        __m128d wr = _mm_unpacklo_pd(w, w);
+        __m128d wi = _mm_unpackhi_pd(w, w);
+        __m128d zs = _mm_shuffle_pd(z, z, 1);
+        return _mm_add_pd(_mm_mul_pd(z, wr), _mm_xor_pd(_mm_mul_pd(zs, wi), neg_lo));
+    }
+
+    UTIL_SIMD_TARGET("sse2")
+    inline void _fft_radix4_sse2(complex < > * data, size_t n, size_t h,
+                                 const complex < > * w1, const complex < > * w2,
+                                 int is)
+    {
+        const __m128d neg_lo = _mm_set_pd(0.0, -0.0);
+        const __m128d neg_rot = (is < 0) ? _mm_set_pd(-0.0, 0.0) : _mm_set_pd(0.0, -0.0);
+        for (size_t i = 0; i < n; i += (h << 2))
+        {
+            double * a = &data[i].re;
+            double * b = a + 2 * h;
+            double * c = b + 2 * h;
+            double * d = c + 2 * h;
+            for (size_t m = 0; m < 2 * h; m += 2)
+            {
+                __m128d vw1 = _mm_loadu_pd(&w1[m / 2].re);
+                __m128d vw2 = _mm_loadu_pd(&w2[m / 2].re);
+                __m128d va = _mm_loadu_pd(a + m), vb = _mm_loadu_pd(b + m);
+                __m128d vc = _mm_loadu_pd(c + m), vd = _mm_loadu_pd(d + m);
+                __m128d tb = _fft_mul_sse2(vw1, vb, neg_lo);
+                __m128d td = _fft_mul_sse2(vw1, vd, neg_lo);
+                __m128d a1 = _mm_add_pd(va, tb), b1 = _mm_sub_pd(va, tb);
+                __m128d c1 = _mm_add_pd(vc, td), d1 = _mm_sub_pd(vc, td);
+                __m128d tc = _fft_mul_sse2(vw2, c1, neg_lo);
+                __m128d t3 = _fft_mul_sse2(vw2, d1, neg_lo);
+                t3 = _mm_xor_pd(_mm_shuffle_pd(t3, t3, 1), neg_rot);
+                _mm_storeu_pd(a + m, _mm_add_pd(a1, tc));
+                _mm_storeu_pd(b + m, _mm_add_pd(b1, t3));
+                _mm_storeu_pd(c + m, _mm_sub_pd(a1, tc));
+                _mm_storeu_pd(d + m, _mm_sub_pd(b1, t3));
+            }
+        }
+    }
+
+    UTIL_SIMD_TARGET("avx")
+    inline __m256d _fft_mul_avx(__m256d w, __m256d z)
+    {
+        __m256d wr = _mm256_movedup_pd(w);
+        __m256d wi = _mm256_permute_pd(w, 0xF);
+        __m256d zs = _mm256_permute_pd(z, 0x5);
+        return _mm256_addsub_pd(_mm256_mul_pd(z, wr), _mm256_mul_pd(zs, wi));
+    }
+
+    /* processes two complex values per instruction; requires `h >= 2` */
+    UTIL_SIMD_TARGET("avx")
+    inline void _fft_radix4_avx(complex < > * data, size_t n, size_t h,
+                                const complex < > * w1, const complex < > * w2,
+                                int is)
+    {
+        const __m256d neg_rot = (is < 0) ? _mm256_set_pd(-0.0, 0.0, -0.0, 0.0)
+                                         : _mm256_set_pd(0.0, -0.0, 0.0, -0.0);
+        for (size_t i = 0; i < n; i += (h << 2))
+        {
+            double * a = &data[i].re;
+            double * b = a + 2 * h;
+            double * c = b + 2 * h;
+            double * d = c + 2 * h;
+            for (size_t m = 0; m < 2 * h; m += 4)
+            {
+                __m256d vw1 = _mm256_loadu_pd(&w1[m / 2].re);
+                __m256d vw2 = _mm256_loadu_pd(&w2[m / 2].re);
+                __m256d va = _mm256_loadu_pd(a + m), vb = _mm256_loadu_pd(b + m);
+                __m256d vc = _mm256_loadu_pd(c + m), vd = _mm256_loadu_pd(d + m);
+                __m256d tb = _fft_mul_avx(vw1, vb);
+                __m256d td = _fft_mul_avx(vw1, vd);
+                __m256d a1 = _mm256_add_pd(va, tb), b1 = _mm256_sub_pd(va, tb);
+                __m256d c1 = _mm256_add_pd(vc, td), d1 = _mm256_sub_pd(vc, td);
+                __m256d tc = _fft_mul_avx(vw2, c1);
+                __m256d t3 = _fft_mul_avx(vw2, d1);
+                t3 = _mm256_xor_pd(_mm256_permute_pd(t3, 0x5), neg_rot);
+                _mm256_storeu_pd(a + m, _mm256_add_pd(a1, tc));
+                _mm256_storeu_pd(b + m, _mm256_add_pd(b1, t3));
+                _mm256_storeu_pd(c + m, _mm256_sub_pd(a1, tc));
+                _mm256_storeu_pd(d + m, _mm256_sub_pd(b1, t3));
+            }
+        }
+        _mm256_zeroupper();
+    }
+
+#endif
+
+    /*****************************************************/
+    /*                 Stockham kernels                  */
+    /*****************************************************/
+
+    /* A Stockham pass of radix `r` reads `r` contiguous parts of `x`
+       and writes contiguous runs of `ns` values into `y`, so that
+       the output of the last pass comes out in natural order
+       without a permutation; `w` holds W(r * ns)^(q * k) for
+       `q = 1 .. r - 1` (outer) and `k < ns` (inner). */
+
+    inline void _fft_stockham2(const complex < > * x, complex < > * y,
+                               size_t n, size_t ns, const complex < > * w)
+    {
+        size_t q = n / 2;
+        for (size_t j = 0; j < q; j += ns)
+        {
+            const complex < > * x0 = x + j, * x1 = x0 + q;
+            complex < > * y0 = y + 2 * j, * y1 = y0 + ns;
+            for (size_t k = 0; k < ns; ++k)
+            {
+                complex < > a1 = _fft_mul(w[k], x1[k]);
+                y0[k] = x0[k] + a1;
+                y1[k] = x0[k] - a1;
+            }
+        }
+    }
+
+    inline void _fft_stockham4_scalar(const complex < > * x, complex < > * y,
+                                      size_t n, size_t ns, const complex < > * w,
+                                      int is)
+    {
+        size_t q = n / 4;
+        const complex < > * w1 = w, * w2 = w1 + ns, * w3 = w2 + ns;
+        for (size_t j = 0; j < q; j += ns)
+        {
+            const complex < > * x0 = x + j, * x1 = x0 + q, * x2 = x1 + q, * x3 = x2 + q;
+            complex < > * y0 = y + 4 * j, * y1 = y0 + ns, * y2 = y1 + ns, * y3 = y2 + ns;
+            for (size_t k = 0; k < ns; ++k)
+            {
+                complex < > a0 = x0[k];
+                complex < > a1 = _fft_mul(w1[k], x1[k]);
+                complex < > a2 = _fft_mul(w2[k], x2[k]);
+                complex < > a3 = _fft_mul(w3[k], x3[k]);
+                complex < > t0 = a0 + a2, t1 = a0 - a2;
+                complex < > t2 = a1 + a3, t3 = _fft_rotate(a1 - a3, is);
+                y0[k] = t0 + t2;
+                y1[k] = t1 + t3;
+                y2[k] = t0 - t2;
+                y3[k] = t1 - t3;
+            }
+        }
+    }
+
+#ifdef UTIL_SIMD_X86
+
+    /* processes two complex values per instruction; requires `ns >= 2` */
+    UTIL_SIMD_TARGET("avx")
+    inline void _fft_stockham4_avx(const complex < > * x, complex < > * y,
+                                   size_t n, size_t ns, const complex < > * w,
+                                   int is)
+    {
+        const __m256d neg_rot = (is < 0) ? _mm256_set_pd(-0.0, 0.0, -0.0, 0.0)
+                                         : _mm256_set_pd(0.0, -0.0, 0.0, -0.0);
+        size_t q = n / 4;
+        const double * w1 = &w[0].re, * w2 = w1 + 2 * ns, * w3 = w2 + 2 * ns;
+        for (size_t j = 0; j < q; j += ns)
+        {
+            const double * x0 = &x[j].re, * x1 = x0 + 2 * q, * x2 = x1 + 2 * q, * x3 = x2 + 2 * q;
+            double * y0 = &y[4 * j].re, * y1 = y0 + 2 * ns, * y2 = y1 + 2 * ns, * y3 = y2 + 2 * ns;
+            for (size_t k = 0; k < 2 * ns; k += 4)
+            {
+                __m256d a0 = _mm256_loadu_pd(x0 + k);
+                __m256d a1 = _fft_mul_avx(_mm256_loadu_pd(w1 + k), _mm256_loadu_pd(x1 + k));
+                __m256d a2 = _fft_mul_avx(_mm256_loadu_pd(w2 + k), _mm256_loadu_pd(x2 + k));
+                __m256d a3 = _fft_mul_avx(_mm256_loadu_pd(w3 + k), _mm256_loadu_pd(x3 + k));
+                __m256d t0 = _mm256_add_pd(a0, a2), t1 = _mm256_sub_pd(a0, a2);
+                __m256d t2 = _mm256_add_pd(a1, a3), t3 = _mm256_sub_pd(a1, a3);
+                t3 = _mm256_xor_pd(_mm256_permute_pd(t3, 0x5), neg_rot);
+                _mm256_storeu_pd(y0 + k, _mm256_add_pd(t0, t2));
+                _mm256_storeu_pd(y1 + k, _mm256_add_pd(t1, t3));
+                _mm256_storeu_pd(y2 + k, _mm256_sub_pd(t0, t2));
+                _mm256_storeu_pd(y3 + k, _mm256_sub_pd(t1, t3));
+            }
+        }
+        _mm256_zeroupper();
+    }
+
+#endif
+
+    inline void _fft_stockham4(simd::level isa,
+                               const complex < > * x, complex < > * y,
+                               size_t n, size_t ns, const complex < > * w,
+                               int is)
+    {
+    #ifdef UTIL_SIMD_X86
+        if ((isa >= simd::avx) && (ns >= 2)) { _fft_stockham4_avx(x, y, n, ns, w, is); return; }
+    #endif
+        _fft_stockham4_scalar(x, y, n, ns, w, is);
+    }
+
+    /* cache-blocked out-of-place transpose of
+       the `rows x cols` row-major matrix */
+    inline void _fft_transpose(const complex < > * in, complex < > * out,
+                               size_t rows, size_t cols)
+    {
+        const size_t block = 32;
+        for (size_t r0 = 0; r0 < rows; r0 += block)
+        for (size_t c0 = 0; c0 < cols; c0 += block)
+        {
+            size_t r1 = (std::min)(r0 + block, rows);
+            size_t c1 = (std::min)(c0 + block, cols);
+            for (size_t r = r0; r < r1; ++r)
+            for (size_t c = c0; c < c1; ++c)
+            {
+                out[c * rows + r] = in[r * cols + c];
+            }
+        }
+    }
+
+    /* cache-blocked in-place transpose of
+       the `n x n` row-major matrix */
+    inline void _fft_transpose(complex < > * data, size_t n)
+    {
+        const size_t block = 32;
+        for (size_t r0 = 0; r0 < n; r0 += block)
+        for (size_t c0 = r0; c0 < n; c0 += block)
+        {
+            size_t r1 = (std::min)(r0 + block, n);
+            size_t c1 = (std::min)(c0 + block, n);
+            for (size_t r = r0; r < r1; ++r)
+            for (size_t c = (std::max)(c0, r + 1); c < c1; ++c)
+            {
+                std::swap(data[r * n + c], data[c * n + r]);
+            }
+        }
+    }
+
+    inline void _fft_radix4(simd::level isa,
+                            complex < > * data, size_t n, size_t h,
+                            const complex < > * w1, const complex < > * w2,
+                            int is)
+    {
+    #ifdef UTIL_SIMD_X86
+        if ((isa >= simd::avx) && (h >= 2)) { _fft_radix4_avx(data, n, h, w1, w2, is); return; }
+        if (isa >= simd::sse2) { _fft_radix4_sse2(data, n, h, w1, w2, is); return; }
+    #endif
+        _fft_radix4_scalar(data, n, h, w1, w2, is);
+    }
+}
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                     fft_plan                      */
+    /*****************************************************/
+
+    /**
+     * Precomputed transform of the fixed length `n` in the
+     * fixed direction `is`. Follows `fourier` conventions:
+     * `is < 0` is the forward transform, `is > 0` is the
+     * inverse one normalized by `n`.
+     *
+     * The plan is built once and may be executed any number
+     * of times; `execute` does not modify the plan, so
+     * a single plan may be shared between threads.
+     *
+     * Any `n` is supported without padding:
+     *      powers of two      - in-place radix-4 (and one radix-2
+     *                           stage for odd powers), using the
+     *                           best SIMD kernel up to `isa`;
+     *                           for large `n` - out-of-place
+     *                           Stockham autosort; on request -
+     *                           six-step decomposition
+     *      2^a * 3^b * 5^c    - mixed-radix (4, 2, 3, 5)
+     *      other lengths      - Bluestein chirp-z transform
+     *                           over the power-of-two plans
+     *
+     * All but the in-place power-of-two transform need
+     * `scratch_size()` complex values of scratch memory;
+     * pass it explicitly to avoid allocating it on every call.
+     *
+     * `isa` limits the instruction set of the kernels; the
+     * plan never uses more than `simd::detect()` reports.
+     */
+    class fft_plan
+    {
+
+    public:
+
+        enum algorithm
+        {
+            automatic,
+            power_of_two,
+            stockham,
+            six_step,
+            mixed_radix,
+            bluestein
+        };
+
+        /* the smallest power-of-two length for which `automatic`
+           selects `stockham`: 64 MiB of data exceed the last level
+           cache of most CPUs, so the strided in-place passes start
+           missing cache and TLB on every access; `six_step` is
+           never selected automatically, it helps only where the
+           TLB reach is far below `n` */
+        static size_t stockham_threshold() { return (size_t) 1 << 22; }
+
+    private:
+
+        size_t n;
+        int is;
+        algorithm algo;
+        simd::level isa;
+
+        /* power_of_two: twiddles of the stage with half-size `h`
+           occupy the range [h - 1, 2h - 1);
+           stockham: W(r * ns)^(q * k), 0 < q < r, k < ns, packed
+           by stages of radix `r` and span `ns`, then by `q`;
+           six_step: exp(is * 2pi * i * m / n) for m < 2^lo_bits
+           followed by the ones for m = t * 2^lo_bits;
+           mixed_radix: exp(is * 2pi * i * k / n), k < n;
+           bluestein: chirp exp(is * pi * i * k^2 / n), k < n */
+        std::vector < complex < > > twiddles;
+
+        /* power_of_two: bit-reversal permutation as a list
+           of the (i, j), i < j index pairs to swap */
+        std::vector < std::pair < size_t, size_t > > swaps;
+
+        /* mixed_radix: (radix, remaining length) pairs */
+        std::vector < size_t > factors;
+
+        /* six_step: `n = n1 * n2` and the split twiddle table size */
+        size_t n1, n2, lo_bits;
+
+        /* bluestein: forward transform of the conjugate chirp */
+        std::vector < complex < > > chirp_fft;
+
+        /* bluestein: forward and inverse convolution plans;
+           six_step: length `n1` and `n2` row plans */
+        util::ptr_t < fft_plan > sub1, sub2;
+
+    public:
+
+        fft_plan(size_t n, int is, simd::level isa = simd::avx2)
+            : n(n)
+            , is(is)
+            , isa(simd::select(isa))
+        {
+            _init(automatic);
+        }
+
+        /**
+         * Forces the given `algo`; `power_of_two`, `stockham`
+         * and `six_step` require `n` to be a power of two,
+         * `mixed_radix` requires `n = 2^a * 3^b * 5^c`.
+         */
+        fft_plan(size_t n, int is, algorithm algo, simd::level isa = simd::avx2)
+            : n(n)
+            , is(is)
+            , isa(simd::select(isa))
+        {
+            _init(algo);
+        }
+
+        size_t size() const { return n; }
+
+        int direction() const { return is; }
+
+        algorithm kind() const { return algo; }
+
+        simd::level instruction_set() const { return isa; }
+
+        /**
+         * The number of complex values of scratch
+         * memory required by `execute`.
+         */
+        size_t scratch_size() const
+        {
+            switch (algo)
+            {
+            case stockham:
+            case six_step:
+            case mixed_radix: return n;
+            case bluestein:   return sub1->size();
+            default:          return 0;
+            }
+        }
+
+        void execute(complex < > * data, complex < > * scratch) const
+        {
+            switch (algo)
+            {
+            case power_of_two: _execute_power_of_two(data);          break;
+            case stockham:     _execute_stockham(data, scratch);    break;
+            case six_step:     _execute_six_step(data, scratch);    break;
+            case mixed_radix:  _execute_mixed_radix(data, scratch); break;
+            case bluestein:    _execute_bluestein(data, scratch);   break;
+            default:           break;
+            }
+
+            /* six-step row plans are normalized themselves */
+            if ((is > 0) && (algo != six_step))
+            {
+                double f = 1. / n;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    data[i].re *= f;
+                    data[i].im *= f;
+                }
+            }
+        }
+
+        void execute(complex < > * data) const
+        {
+            std::vector < complex < > > scratch(scratch_size());
+            execute(data, scratch.data());
+        }
+
+        void operator () (complex < > * data) const
+        {
+            execute(data);
+        }
+
+        void operator () (complex < > * data, complex < > * scratch) const
+        {
+            execute(data, scratch);
+        }
+
+    private:
+
+        void _init(algorithm hint)
+        {
+            assert(n > 0);
+
+            bool pow2 = ((n & (n - 1)) == 0);
+
+            if (hint == automatic)
+            {
+                if (pow2) hint = (n >= stockham_threshold()) ? stockham : power_of_two;
+                else      hint = _factorize() ? mixed_radix : bluestein;
+            }
+
+            algo = hint;
+
+            switch (algo)
+            {
+            case power_of_two: assert(pow2); _init_power_of_two(); break;
+            case stockham:     assert(pow2); _init_stockham();     break;
+            case six_step:     assert(pow2); _init_six_step();     break;
+            case mixed_radix:
+                if (factors.empty()) _factorize();
+                assert(!factors.empty());
+                _init_mixed_radix();
+                break;
+            default:           _init_bluestein();                  break;
+            }
+        }
+
+        void _init_power_of_two()
+        {
+            twiddles.resize(n > 1 ? n - 1 : 0);
+            for (size_t h = 1; h < n; h <<= 1)
+            {
+                for (size_t m = 0; m < h; ++m)
+                {
+                    double theta = is * M_PI * m / h;
+                    twiddles[h - 1 + m] = { std::cos(theta), std::sin(theta) };
+                }
+            }
+
+            for (size_t i = 0, j = 0; i < n; ++i)
+            {
+                if (i < j) swaps.emplace_back(i, j);
+                size_t m = n >> 1;
+                while ((m > 0) && (j >= m)) { j -= m; m >>= 1; }
+                j += m;
+            }
+        }
+
+        bool _factorize()
+        {
+            static const size_t radices[] = { 4, 2, 3, 5 };
+            size_t m = n;
+            for (size_t r = 0; r < 4; ++r)
+            {
+                while (m % radices[r] == 0)
+                {
+                    m /= radices[r];
+                    factors.push_back(radices[r]);
+                    factors.push_back(m);
+                }
+            }
+            if (m == 1) return true;
+            factors.clear();
+            return false;
+        }
+
+        void _init_mixed_radix()
+        {
+            twiddles.resize(n);
+            for (size_t k = 0; k < n; ++k)
+            {
+                double theta = is * 2 * M_PI * k / n;
+                twiddles[k] = { std::cos(theta), std::sin(theta) };
+            }
+        }
+
+        void _init_bluestein()
+        {
+            size_t m = 1;
+            while (m < 2 * n - 1) m <<= 1;
+
+            twiddles.resize(n);
+            for (size_t k = 0; k < n; ++k)
+            {
+                /* k^2 mod 2n keeps the angle small and exact */
+                unsigned long long k2 = ((unsigned long long) k * k) % (2 * n);
+                double theta = is * M_PI * k2 / n;
+                twiddles[k] = { std::cos(theta), std::sin(theta) };
+            }
+
+            sub1 = util::create < fft_plan > (m, -1, power_of_two, isa);
+            sub2 = util::create < fft_plan > (m, 1, power_of_two, isa);
+
+            chirp_fft.assign(m, complex < > ());
+            chirp_fft[0] = conjugate(twiddles[0]);
+            for (size_t k = 1; k < n; ++k)
+            {
+                chirp_fft[k] = chirp_fft[m - k] = conjugate(twiddles[k]);
+            }
+            sub1->execute(chirp_fft.data());
+        }
+
+        void _init_stockham()
+        {
+            for (size_t ns = 1; ns < n; )
+            {
+                size_t r = (n / ns >= 4) ? 4 : 2;
+                for (size_t q = 1; q < r; ++q)
+                {
+                    for (size_t k = 0; k < ns; ++k)
+                    {
+                        double theta = is * 2 * M_PI * (q * k) / (r * ns);
+                        twiddles.push_back(complex < > (std::cos(theta), std::sin(theta)));
+                    }
+                }
+                ns *= r;
+            }
+        }
+
+        void _init_six_step()
+        {
+            size_t log2n = 0;
+            while (((size_t) 1 << log2n) < n) ++log2n;
+
+            n1 = (size_t) 1 << ((log2n + 1) / 2);
+            n2 = n / n1;
+            lo_bits = (log2n + 1) / 2;
+
+            size_t lo_size = (size_t) 1 << lo_bits;
+
+            twiddles.resize(lo_size + n / lo_size);
+            for (size_t m = 0; m < lo_size; ++m)
+            {
+                double theta = is * 2 * M_PI * m / n;
+                twiddles[m] = { std::cos(theta), std::sin(theta) };
+            }
+            for (size_t t = 0; t < n / lo_size; ++t)
+            {
+                double theta = is * 2 * M_PI * (t * lo_size) / n;
+                twiddles[lo_size + t] = { std::cos(theta), std::sin(theta) };
+            }
+
+            sub1 = util::create < fft_plan > (n1, is, power_of_two, isa);
+            sub2 = util::create < fft_plan > (n2, is, power_of_two, isa);
+        }
+
+        void _execute_power_of_two(complex < > * data) const
+        {
+            for (size_t s = 0; s < swaps.size(); ++s)
+            {
+                std::swap(data[swaps[s].first], data[swaps[s].second]);
+            }
+
+            size_t log2n = 0;
+            while (((size_t) 1 << log2n) < n) ++log2n;
+
+            size_t h = 1;
+            if (log2n % 2 == 1)
+            {
+                for (size_t i = 0; i < n; i += 2)
+                {
+                    complex < > t = data[i + 1];
+                    data[i + 1] = data[i] - t;
+                    data[i] = data[i] + t;
+                }
+                h = 2;
+            }
+
+            for (; h < n; h <<= 2)
+            {
+                _fft_radix4(isa, data, n, h,
+                            twiddles.data() + h - 1,
+                            twiddles.data() + 2 * h - 1,
+                            is);
+            }
+        }
+
+        void _execute_stockham(complex < > * data, complex < > * scratch) const
+        {
+            complex < > * x = data, * y = scratch;
+            const complex < > * w = twiddles.data();
+            for (size_t ns = 1; ns < n; )
+            {
+                size_t r = (n / ns >= 4) ? 4 : 2;
+                if (r == 4) _fft_stockham4(isa, x, y, n, ns, w, is);
+                else        _fft_stockham2(x, y, n, ns, w);
+                w += (r - 1) * ns;
+                ns *= r;
+                std::swap(x, y);
+            }
+            if (x != data) std::copy(x, x + n, data);
+        }
+
+        /* x as `n1 x n2` row-major matrix, `j = n2 * j1 + j2`,
+           `k = k1 + n1 * k2`:
+               1. transpose into `n2 x n1`
+               2. length-`n1` FFT of each row, then multiply
+                  the element (j2, k1) by W(n)^(j2 * k1)
+               3. transpose into `n1 x n2`
+               4. length-`n2` FFT of each row
+               5. transpose into `n2 x n1` (natural order),
+                  in place if the matrix is square
+           every pass streams through contiguous rows */
+        void _execute_six_step(complex < > * data, complex < > * scratch) const
+        {
+            const complex < > * lo = twiddles.data();
+            const complex < > * hi = lo + ((size_t) 1 << lo_bits);
+            size_t lo_mask = ((size_t) 1 << lo_bits) - 1;
+
+            _fft_transpose(data, scratch, n1, n2);
+
+            for (size_t j2 = 0; j2 < n2; ++j2)
+            {
+                complex < > * row = scratch + j2 * n1;
+                sub1->execute(row);
+                for (size_t k1 = 1; k1 < n1; ++k1)
+                {
+                    size_t m = j2 * k1;
+                    row[k1] = _fft_mul(_fft_mul(hi[m >> lo_bits], lo[m & lo_mask]), row[k1]);
+                }
+            }
+
+            _fft_transpose(scratch, data, n2, n1);
+
+            for (size_t k1 = 0; k1 < n1; ++k1)
+            {
+                sub2->execute(data + k1 * n2);
+            }
+
+            if (n1 == n2)
+            {
+                _fft_transpose(data, n1);
+            }
+            else
+            {
+                _fft_transpose(data, scratch, n1, n2);
+                std::copy(scratch, scratch + n, data);
+            }
+        }
+
+        void _execute_mixed_radix(complex < > * data, complex < > * scratch) const
+        {
+            std::copy(data, data + n, scratch);
+            _mixed_radix_pass(data, scratch, 1, 0);
+        }
+
+        /* decimation in time: transforms `p` interleaved sub-sequences
+           of `in` (stride `p * stride`) recursively into consecutive
+           blocks of `out` and then combines them with radix-`p`
+           butterflies */
+        void _mixed_radix_pass(complex < > * out, const complex < > * in,
+                               size_t stride, size_t f) const
+        {
+            size_t p = factors[f], m = factors[f + 1];
+
+            if (m == 1)
+            {
+                for (size_t q = 0; q < p; ++q) out[q] = in[q * stride];
+            }
+            else
+            {
+                for (size_t q = 0; q < p; ++q)
+                {
+                    _mixed_radix_pass(out + q * m, in + q * stride, stride * p, f + 2);
+                }
+            }
+
+            switch (p)
+            {
+            case 2: _butterfly2(out, stride, m); break;
+            case 3: _butterfly3(out, stride, m); break;
+            case 4: _butterfly4(out, stride, m); break;
+            case 5: _butterfly5(out, stride, m); break;
+            }
+        }
+
+        void _butterfly2(complex < > * out, size_t stride, size_t m) const
+        {
+            for (size_t k = 0; k < m; ++k)
+            {
+                complex < > t = out[k + m] * twiddles[k * stride];
+                out[k + m] = out[k] - t;
+                out[k] = out[k] + t;
+            }
+        }
+
+        void _butterfly3(complex < > * out, size_t stride, size_t m) const
+        {
+            const double h = 0.86602540378443864676; /* sin(2pi/3) */
+            for (size_t k = 0; k < m; ++k)
+            {
+                complex < > a0 = out[k];
+                complex < > a1 = out[k + m] * twiddles[k * stride];
+                complex < > a2 = out[k + 2 * m] * twiddles[2 * k * stride];
+                complex < > t1 = a1 + a2, t2 = _fft_rotate(a1 - a2, is) * h;
+                complex < > c = a0 - t1 * 0.5;
+                out[k]         = a0 + t1;
+                out[k + m]     = c + t2;
+                out[k + 2 * m] = c - t2;
+            }
+        }
+
+        void _butterfly4(complex < > * out, size_t stride, size_t m) const
+        {
+            for (size_t k = 0; k < m; ++k)
+            {
+                complex < > a0 = out[k];
+                complex < > a1 = out[k + m] * twiddles[k * stride];
+                complex < > a2 = out[k + 2 * m] * twiddles[2 * k * stride];
+                complex < > a3 = out[k + 3 * m] * twiddles[3 * k * stride];
+                complex < > t0 = a0 + a2, t1 = a0 - a2;
+                complex < > t2 = a1 + a3, t3 = _fft_rotate(a1 - a3, is);
+                out[k]         = t0 + t2;
+                out[k + m]     = t1 + t3;
+                out[k + 2 * m] = t0 - t2;
+                out[k + 3 * m] = t1 - t3;
+            }
+        }
+
+        void _butterfly5(complex < > * out, size_t stride, size_t m) const
+        {
+            const double c1 =  0.30901699437494742410; /* cos(2pi/5) */
+            const double c2 = -0.80901699437494742410; /* cos(4pi/5) */
+            const double s1 =  0.95105651629515357212; /* sin(2pi/5) */
+            const double s2 =  0.58778525229247312917; /* sin(4pi/5) */
+            for (size_t k = 0; k < m; ++k)
+            {
+                complex < > a0 = out[k];
+                complex < > a1 = out[k + m] * twiddles[k * stride];
+                complex < > a2 = out[k + 2 * m] * twiddles[2 * k * stride];
+                complex < > a3 = out[k + 3 * m] * twiddles[3 * k * stride];
+                complex < > a4 = out[k + 4 * m] * twiddles[4 * k * stride];
+                complex < > b1 = a1 + a4, b2 = a2 + a3;
+                complex < > d1 = a1 - a4, d2 = a2 - a3;
+                complex < > e1 = a0 + b1 * c1 + b2 * c2;
+                complex < > e2 = a0 + b1 * c2 + b2 * c1;
+                complex < > r1 = _fft_rotate(d1 * s1 + d2 * s2, is);
+                complex < > r2 = _fft_rotate(d1 * s2 - d2 * s1, is);
+                out[k]         = a0 + b1 + b2;
+                out[k + m]     = e1 + r1;
+                out[k + 4 * m] = e1 - r1;
+                out[k + 2 * m] = e2 + r2;
+                out[k + 3 * m] = e2 - r2;
+            }
+        }
+
+        void _execute_bluestein(complex < > * data, complex < > * scratch) const
+        {
+            size_t m = sub1->size();
+
+            for (size_t k = 0; k < n; ++k) scratch[k] = data[k] * twiddles[k];
+            std::fill(scratch + n, scratch + m, complex < > ());
+
+            sub1->execute(scratch);
+            for (size_t k = 0; k < m; ++k) scratch[k] = scratch[k] * chirp_fft[k];
+            sub2->execute(scratch);
+
+            for (size_t k = 0; k < n; ++k) data[k] = scratch[k] * twiddles[k];
+        }
+    };
+}
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                    rfft_plan                      */
+    /*****************************************************/
+
+    /**
+     * Precomputed transform of the real signal of the fixed
+     * even length `n`. The signal is packed into `n/2` complex
+     * values, transformed by the half-length `fft_plan` and
+     * post-processed, so no full-length complex buffer is used.
+     *
+     * The spectrum of the real signal is hermitian, so only
+     * its first `n/2 + 1` bins are stored.
+     *
+     * `is < 0` - forward (real-to-complex) transform,
+     * `is > 0` - inverse (complex-to-real) transform
+     *            normalized by `n`.
+     *
+     * Any even `n` is supported; see `fft_plan` for
+     * the scratch memory requirements.
+     */
+    class rfft_plan
+    {
+
+    private:
+
+        size_t n;
+        int is;
+
+        fft_plan half;
+
+        /* exp(is * 2pi * i * k / n), k = 0 .. n/2 - 1 */
+        std::vector < complex < > > twiddles;
+
+    public:
+
+        rfft_plan(size_t n, int is, simd::level isa = simd::avx2)
+            : n(n)
+            , is(is)
+            , half(n / 2, is, isa)
+            , twiddles(n / 2)
+        {
+            static_assert(sizeof(complex < >) == 2 * sizeof(double),
+                          "complex < > must be layout-compatible with double[2]");
+            assert((n >= 2) && (n % 2 == 0));
+            for (size_t k = 0; k < n / 2; ++k)
+            {
+                double theta = is * 2 * M_PI * k / n;
+                twiddles[k] = { std::cos(theta), std::sin(theta) };
+            }
+        }
+
+        size_t size() const { return n; }
+
+        int direction() const { return is; }
+
+        /**
+         * The number of the complex bins in the spectrum.
+         */
+        size_t spectrum_size() const { return n / 2 + 1; }
+
+        size_t scratch_size() const { return half.scratch_size(); }
+
+        /**
+         * Forward transform of `n` real samples into
+         * `n/2 + 1` spectrum bins.
+         */
+        void execute(const double * input, complex < > * output, complex < > * scratch) const
+        {
+            assert(is < 0);
+
+            size_t m = n / 2;
+
+            for (size_t k = 0; k < m; ++k)
+            {
+                output[k] = { input[2 * k], input[2 * k + 1] };
+            }
+
+            half.execute(output, scratch);
+
+            complex < > z0 = output[0];
+            output[0] = { z0.re + z0.im, 0 };
+            output[m] = { z0.re - z0.im, 0 };
+
+            for (size_t k = 1; k <= m / 2; ++k)
+            {
+                complex < > z1 = output[k], z2 = conjugate(output[m - k]);
+                complex < > e = (z1 + z2) * 0.5;
+                complex < > o = (z1 - z2) * 0.5;
+                o = { o.im, - o.re }; /* o / i */
+                output[k]     = e + twiddles[k] * o;
+                output[m - k] = conjugate(e) + twiddles[m - k] * conjugate(o);
+            }
+        }
+
+        /**
+         * Inverse transform of `n/2 + 1` spectrum bins
+         * into `n` real samples.
+         */
+        void execute(const complex < > * input, double * output, complex < > * scratch) const
+        {
+            assert(is > 0);
+
+            size_t m = n / 2;
+
+            /* the `n` doubles are used in-place as `n/2`
+               interleaved complex values */
+            complex < > * z = reinterpret_cast < complex < > * > (output);
+
+            for (size_t k = 0; k < m; ++k)
+            {
+                complex < > x2 = conjugate(input[m - k]);
+                complex < > e = (input[k] + x2) * 0.5;
+                complex < > o = (input[k] - x2) * 0.5 * twiddles[k];
+                z[k] = { e.re - o.im, e.im + o.re }; /* e + i o */
+            }
+
+            half.execute(z, scratch);
+        }
+
+        void execute(const double * input, complex < > * output) const
+        {
+            std::vector < complex < > > scratch(scratch_size());
+            execute(input, output, scratch.data());
+        }
+
+        void execute(const complex < > * input, double * output) const
+        {
+            std::vector < complex < > > scratch(scratch_size());
+            execute(input, output, scratch.data());
+        }
+
+        void execute(const sampled_t & input, complex < > * output) const
+        {
+            assert(input.count == n);
+            execute(input.samples, output);
+        }
+
+        void execute(const complex < > * input, sampled_t & output) const
+        {
+            assert(output.count == n);
+            execute(input, output.samples);
+        }
+    };
+}
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                    fft_batch                      */
+    /*****************************************************/
+
+    /**
+     * Same-length transform of a block of `count` channels,
+     * spread across the workers of a `util::thread_pool`.
+     *
+     * The element `i` of the channel `c` is located at
+     * `data[c * dist + i * stride]`, e.g.
+     *      contiguous channels:  stride = 1,     dist = n
+     *      interleaved channels: stride = count, dist = 1
+     *
+     * A single plan is shared by all workers; each worker
+     * owns its scratch buffer (also used to gather strided
+     * channels), allocated on the first `execute` only.
+     */
+    class fft_batch
+    {
+
+    private:
+
+        fft_plan plan;
+        size_t count, stride, dist;
+
+        std::vector < std::vector < complex < > > > scratch;
+
+    public:
+
+        fft_batch(size_t n, int is,
+                  size_t count, size_t stride, size_t dist,
+                  simd::level isa = simd::avx2)
+            : plan(n, is, isa)
+            , count(count)
+            , stride(stride)
+            , dist(dist)
+        {
+        }
+
+        const fft_plan & get_plan() const { return plan; }
+
+        size_t channels() const { return count; }
+
+        void execute(complex < > * data, util::thread_pool & pool)
+        {
+            size_t n = plan.size();
+            size_t gather = (stride == 1) ? 0 : n;
+
+            if (scratch.size() < pool.size()) scratch.resize(pool.size());
+            for (size_t w = 0; w < scratch.size(); ++w)
+            {
+                scratch[w].resize(plan.scratch_size() + gather);
+            }
+
+            pool.run(count, [&] (size_t c, size_t w)
+            {
+                complex < > * channel = data + c * dist;
+                complex < > * buf = scratch[w].data();
+                if (gather == 0)
+                {
+                    plan.execute(channel, buf);
+                    return;
+                }
+                complex < > * tmp = buf + plan.scratch_size();
+                for (size_t i = 0; i < n; ++i) tmp[i] = channel[i * stride];
+                plan.execute(tmp, buf);
+                for (size_t i = 0; i < n; ++i) channel[i * stride] = tmp[i];
+            });
+        }
+    };
+}
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+
+#include <util/common/math/common.h>
+#include <util/common/math/simd.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                   xoshiro256                      */
+    /*****************************************************/
+
+    /**
+     * xoshiro256** pseudo-random generator.
+     *
+     * The state is seeded by splitmix64, so equal seeds give
+     * equal sequences on every platform. The generator is not
+     * synchronized: keep one instance per thread, e.g. created
+     * by `stream(seed, worker)`, which yields non-overlapping
+     * subsequences (2^128 numbers apart) of the same seed.
+     */
+    class xoshiro256
+    {
+
+    private:
+
+        uint64_t s[4];
+
+    public:
+
+        explicit xoshiro256(uint64_t seed = 0)
+        {
+            this->seed(seed);
+        }
+
+        /**
+         * The `index`-th independent stream of `seed`.
+         */
+        static xoshiro256 stream(uint64_t seed, size_t index)
+        {
+            xoshiro256 g(seed);
+            for (size_t i = 0; i < index; ++i) g.jump();
+            return g;
+        }
+
+        void seed(uint64_t seed)
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                s[i] = z ^ (z >> 31);
+            }
+        }
+
+        uint64_t next()
+        {
+            uint64_t result = _rotate(s[1] * 5, 7) * 9;
+            uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = _rotate(s[3], 45);
+            return result;
+        }
+
+        /**
+         * Uniform in [0, 1).
+         */
+        double uniform()
+        {
+            return (next() >> 11) * (1. / 9007199254740992.);
+        }
+
+        /**
+         * Uniform in [left, right).
+         */
+        double uniform(double left, double right)
+        {
+            return uniform() * (right - left) + left;
+        }
+
+        /**
+         * Advances the state by 2^128 steps.
+         */
+        void jump()
+        {
+            static const uint64_t poly[4] =
+            {
+                0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+            };
+            uint64_t t[4] = { 0, 0, 0, 0 };
+            for (size_t i = 0; i < 4; ++i)
+            for (size_t b = 0; b < 64; ++b)
+            {
+                if (poly[i] & (1ULL << b))
+                {
+                    t[0] ^= s[0]; t[1] ^= s[1]; t[2] ^= s[2]; t[3] ^= s[3];
+                }
+                next();
+            }
+            s[0] = t[0]; s[1] = t[1]; s[2] = t[2]; s[3] = t[3];
+        }
+
+    private:
+
+        static uint64_t _rotate(uint64_t x, int k)
+        {
+            return (x << k) | (x >> (64 - k));
+        }
+    };
+
+    /*****************************************************/
+    /*              scalar approximations                */
+    /*****************************************************/
+
+    /* Cephes sin/cos and exp coefficients; the SIMD kernels
+       repeat the scalar operations in the same order, so the
+       paths agree up to the rounding of the multiply-adds
+       a compiler may contract */
+
+    static const double _gen_pi4_1 = 7.85398125648498535156e-1;
+    static const double _gen_pi4_2 = 3.77489470793079817668e-8;
+    static const double _gen_pi4_3 = 2.69515142907905952645e-15;
+
+    static const double _gen_sin[6] =
+    {
+         1.58962301576546568060e-10, -2.50507477628578072866e-8,
+         2.75573136213857245213e-6,  -1.98412698295895385996e-4,
+         8.33333333332211858878e-3,  -1.66666666666666307295e-1
+    };
+    static const double _gen_cos[6] =
+    {
+        -1.13585365213876817300e-11,  2.08757008419747316778e-9,
+        -2.75573141792967388112e-7,   2.48015872888517045348e-5,
+        -1.38888888888730564116e-3,   4.16666666666665929218e-2
+    };
+
+    static const double _gen_exp_p[3] =
+    {
+        1.26177193074810590878e-4, 3.02994407707441961300e-2, 9.99999999999999999910e-1
+    };
+    static const double _gen_exp_q[4] =
+    {
+        3.00198505138664455042e-6, 2.52448340349684104192e-3,
+        2.27265548208155028766e-1, 2.00000000000000000009e0
+    };
+    static const double _gen_ln2_1 = 6.93145751953125e-1;
+    static const double _gen_ln2_2 = 1.42860682030941723212e-6;
+    static const double _gen_exp_min = -708.;
+
+    /**
+     * `sin(2 pi c)`, `c` in cycles; the argument is reduced
+     * to one period first, so the error does not grow with
+     * the sample index.
+     */
+    inline double _gen_sin_cycles(double c)
+    {
+        double x = (c - std::floor(c)) * (2 * M_PI);
+        double j = std::floor(x * (4 / M_PI));
+        j = j + (j - 2 * std::floor(j * 0.5));
+        double o = j - 8 * std::floor(j * 0.125);
+        double z = ((x - j * _gen_pi4_1) - j * _gen_pi4_2) - j * _gen_pi4_3;
+        double zz = z * z;
+        double v;
+        if (o - 4 * std::floor(o * 0.25) == 2)
+        {
+            double p = ((((_gen_cos[0] * zz + _gen_cos[1]) * zz + _gen_cos[2]) * zz + _gen_cos[3]) * zz + _gen_cos[4]) * zz + _gen_cos[5];
+            v = (1 - 0.5 * zz) + zz * zz * p;
+        }
+        else
+        {
+            double p = ((((_gen_sin[0] * zz + _gen_sin[1]) * zz + _gen_sin[2]) * zz + _gen_sin[3]) * zz + _gen_sin[4]) * zz + _gen_sin[5];
+            v = z + z * zz * p;
+        }
+        return (o >= 4) ? - v : v;
+    }
+
+    /**
+     * `exp(x)` for `x <= 0`; flushes to 0 below -708.
+     */
+    inline double _gen_exp_neg(double x)
+    {
+        if (x < _gen_exp_min) return 0;
+        double n = std::floor(x * 1.4426950408889634 + 0.5);
+        x = (x - n * _gen_ln2_1) - n * _gen_ln2_2;
+        double xx = x * x;
+        double px = x * ((_gen_exp_p[0] * xx + _gen_exp_p[1]) * xx + _gen_exp_p[2]);
+        double qx = ((_gen_exp_q[0] * xx + _gen_exp_q[1]) * xx + _gen_exp_q[2]) * xx + _gen_exp_q[3];
+        x = 1 + 2 * (px / (qx - px));
+        return std::ldexp(x, (int) n);
+    }
+
+    /*****************************************************/
+    /*                  SIMD kernels                     */
+    /*****************************************************/
+
+#ifdef UTIL_SIMD_X86
+
+    UTIL_SIMD_TARGET("avx")
+    inline __m256d _gen_poly_avx(__m256d x, const double * c, size_t n)
+    {
+        __m256d p = _mm256_set1_pd(c[0]);
+        for (size_t i = 1; i < n; ++i)
+        {
+            p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(c[i]));
+        }
+        return p;
+    }
+
+    UTIL_SIMD_TARGET("avx")
+    inline __m256d _gen_floor_avx(__m256d x)
+    {
+        return _mm256_round_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    }
+
+    /* out[i] = a sin(2 pi (i step + offset)), i = [0, n & ~3) */
+    UTIL_SIMD_TARGET("avx")
+    inline void _gen_sin_avx(double * out, size_t n, double a, double step, double offset)
+    {
+        const __m256d va = _mm256_set1_pd(a), vstep = _mm256_set1_pd(step);
+        const __m256d voffset = _mm256_set1_pd(offset), four = _mm256_set1_pd(4);
+        const __m256d two = _mm256_set1_pd(2), eight = _mm256_set1_pd(8);
+        const __m256d one = _mm256_set1_pd(1), half = _mm256_set1_pd(0.5);
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        __m256d idx = _mm256_set_pd(3, 2, 1, 0);
+        for (size_t i = 0; i + 4 <= n; i += 4)
+        {
+            __m256d c = _mm256_add_pd(_mm256_mul_pd(idx, vstep), voffset);
+            __m256d x = _mm256_mul_pd(_mm256_sub_pd(c, _gen_floor_avx(c)), _mm256_set1_pd(2 * M_PI));
+            __m256d j = _gen_floor_avx(_mm256_mul_pd(x, _mm256_set1_pd(4 / M_PI)));
+            j = _mm256_add_pd(j, _mm256_sub_pd(j, _mm256_mul_pd(two, _gen_floor_avx(_mm256_mul_pd(j, half)))));
+            __m256d o = _mm256_sub_pd(j, _mm256_mul_pd(eight, _gen_floor_avx(_mm256_mul_pd(j, _mm256_set1_pd(0.125)))));
+            __m256d z = _mm256_sub_pd(x, _mm256_mul_pd(j, _mm256_set1_pd(_gen_pi4_1)));
+            z = _mm256_sub_pd(z, _mm256_mul_pd(j, _mm256_set1_pd(_gen_pi4_2)));
+            z = _mm256_sub_pd(z, _mm256_mul_pd(j, _mm256_set1_pd(_gen_pi4_3)));
+            __m256d zz = _mm256_mul_pd(z, z);
+            __m256d vc = _mm256_add_pd(_mm256_sub_pd(one, _mm256_mul_pd(half, zz)),
+                                       _mm256_mul_pd(_mm256_mul_pd(zz, zz), _gen_poly_avx(zz, _gen_cos, 6)));
+            __m256d vs = _mm256_add_pd(z, _mm256_mul_pd(_mm256_mul_pd(z, zz), _gen_poly_avx(zz, _gen_sin, 6)));
+            __m256d q = _mm256_sub_pd(o, _mm256_mul_pd(four, _gen_floor_avx(_mm256_mul_pd(o, _mm256_set1_pd(0.25)))));
+            __m256d v = _mm256_blendv_pd(vs, vc, _mm256_cmp_pd(q, two, _CMP_EQ_OQ));
+            v = _mm256_xor_pd(v, _mm256_and_pd(_mm256_cmp_pd(o, four, _CMP_GE_OQ), sign));
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(va, v));
+            idx = _mm256_add_pd(idx, four);
+        }
+        _mm256_zeroupper();
+    }
+
+    /* out[i] = a exp(k (i step + offset)^2), i = [0, n & ~3) */
+    UTIL_SIMD_TARGET("avx")
+    inline void _gen_gaussian_avx(double * out, size_t n, double a, double k, double step, double offset)
+    {
+        const __m256d va = _mm256_set1_pd(a), vk = _mm256_set1_pd(k);
+        const __m256d vstep = _mm256_set1_pd(step), voffset = _mm256_set1_pd(offset);
+        const __m256d four = _mm256_set1_pd(4), one = _mm256_set1_pd(1), two = _mm256_set1_pd(2);
+        const __m256d vmin = _mm256_set1_pd(_gen_exp_min);
+        const __m128i bias = _mm_set1_epi64x(1023);
+        __m256d idx = _mm256_set_pd(3, 2, 1, 0);
+        for (size_t i = 0; i + 4 <= n; i += 4)
+        {
+            __m256d u = _mm256_add_pd(_mm256_mul_pd(idx, vstep), voffset);
+            __m256d x0 = _mm256_mul_pd(_mm256_mul_pd(u, u), vk);
+            __m256d underflow = _mm256_cmp_pd(x0, vmin, _CMP_LT_OQ);
+            __m256d x = _mm256_max_pd(x0, vmin);
+            __m256d nn = _gen_floor_avx(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)), _mm256_set1_pd(0.5)));
+            x = _mm256_sub_pd(x, _mm256_mul_pd(nn, _mm256_set1_pd(_gen_ln2_1)));
+            x = _mm256_sub_pd(x, _mm256_mul_pd(nn, _mm256_set1_pd(_gen_ln2_2)));
+            __m256d xx = _mm256_mul_pd(x, x);
+            __m256d px = _mm256_mul_pd(x, _gen_poly_avx(xx, _gen_exp_p, 3));
+            __m256d qx = _gen_poly_avx(xx, _gen_exp_q, 4);
+            x = _mm256_add_pd(one, _mm256_mul_pd(two, _mm256_div_pd(px, _mm256_sub_pd(qx, px))));
+            /* 2^n from the exponent bits */
+            __m128i n32 = _mm256_cvtpd_epi32(nn);
+            __m128i lo = _mm_slli_epi64(_mm_add_epi64(_mm_cvtepi32_epi64(n32), bias), 52);
+            __m128i hi = _mm_slli_epi64(_mm_add_epi64(_mm_cvtepi32_epi64(_mm_srli_si128(n32, 8)), bias), 52);
+            __m256d scale = _mm256_castsi256_pd(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+            x = _mm256_andnot_pd(underflow, _mm256_mul_pd(x, scale));
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(va, x));
+            idx = _mm256_add_pd(idx, four);
+        }
+        _mm256_zeroupper();
+    }
+
+#endif
+
+    inline double _gen_power(const double * samples, size_t n)
+    {
+        double power = 0;
+        for (size_t i = 0; i < n; ++i) power += samples[i] * samples[i];
+        return power;
+    }
+
+    /*****************************************************/
+    /*                 block generators                  */
+    /*****************************************************/
+
+    /* the block generators fill `sampled` directly, the same
+       way `sample(f, sampled)` does with the `continuous_t`
+       of the same name, and return the signal power */
+
+    inline double _sample_sin(sampled_t &sampled, double a, double step, double offset,
+                              simd::level isa)
+    {
+        size_t n = sampled.count, done = 0;
+    #ifdef UTIL_SIMD_X86
+        if (simd::select(isa) >= simd::avx)
+        {
+            _gen_sin_avx(sampled.samples, n, a, step, offset);
+            done = n & ~(size_t) 3;
+        }
+    #endif
+        for (size_t i = done; i < n; ++i)
+        {
+            sampled.samples[i] = a * _gen_sin_cycles(i * step + offset);
+        }
+        return _gen_power(sampled.samples, n);
+    }
+
+    /**
+     * Same as `sample(sin(magnitude, frequency), sampled)`.
+     */
+    inline double sample_sin(sampled_t &sampled, double magnitude, double frequency,
+                             simd::level isa = simd::avx2)
+    {
+        return _sample_sin(sampled, magnitude, frequency * sampled.period, 0, isa);
+    }
+
+    /**
+     * Same as `sample(sin(params), sampled)`.
+     */
+    inline double sample_sin(sampled_t &sampled, sinT_t params,
+                             simd::level isa = simd::avx2)
+    {
+        return _sample_sin(sampled, params.a, sampled.period / params.T, - params.t0 / params.T, isa);
+    }
+
+    /**
+     * Same as `sample(gaussian(params), sampled)`.
+     */
+    inline double sample_gaussian(sampled_t &sampled, gaussian_t params,
+                                  simd::level isa = simd::avx2)
+    {
+        size_t n = sampled.count, done = 0;
+        double k = - 1 / (params.s * params.s);
+    #ifdef UTIL_SIMD_X86
+        if (simd::select(isa) >= simd::avx)
+        {
+            _gen_gaussian_avx(sampled.samples, n, params.a, k, sampled.period, - params.t0);
+            done = n & ~(size_t) 3;
+        }
+    #endif
+        for (size_t i = done; i < n; ++i)
+        {
+            double u = i * sampled.period + (- params.t0);
+            sampled.samples[i] = params.a * _gen_exp_neg(u * u * k);
+        }
+        return _gen_power(sampled.samples, n);
+    }
+
+    /**
+     * Same distribution as `sample(noise(left, right, trust), sampled)`
+     * (the mean of `trust` uniform numbers), drawn from `rng`
+     * instead of the global `rand()`.
+     */
+    inline double sample_noise(sampled_t &sampled, xoshiro256 &rng,
+                               double left = -1, double right = 1, size_t trust = 20)
+    {
+        assert(trust > 0);
+        const double scale = (right - left) / trust / 4294967296.;
+        for (size_t i = 0; i < sampled.count; ++i)
+        {
+            /* two 32-bit uniforms per generator step */
+            uint64_t sum = 0;
+            size_t j = 0;
+            for (; j + 2 <= trust; j += 2)
+            {
+                uint64_t r = rng.next();
+                sum += (r >> 32) + (r & 0xffffffffULL);
+            }
+            if (j < trust) sum += rng.next() >> 32;
+            sampled.samples[i] = left + sum * scale;
+        }
+        return _gen_power(sampled.samples, sampled.count);
+    }
+}
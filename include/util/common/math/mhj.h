@@ -1,5 +1,11 @@
+#pragma once
+
+#include <vector>
+#include <cstdlib>
 #include <functional>
 
+#include <util/common/thread_pool.h>
+
 
 class mhj_impl
 {
@@ -9,6 +15,15 @@ public:
     using args = struct { double *vals; size_t n; };
     using function = std::function < double(double *) > ;
 
+    /**
+     * The objective of the parallel exploration: called
+     * concurrently from the thread pool workers, `worker`
+     * (less than the pool size) may index per-worker scratch;
+     * `point` is valid only during the call. The result must
+     * depend on `point` only.
+     */
+    using concurrent_function = std::function < double(const double * point, size_t worker) > ;
+
 private:
     const int n_count;
     const double eps_proc, eps_opt;
@@ -27,20 +42,76 @@ private:
     args current;
     function func;
 
+    /* the parallel exploration state */
+    concurrent_function cfunc;
+    util::thread_pool * pool;
+    size_t probes;
+    std::vector < std::vector < double > > points;
+    std::vector < double > delta, values;
+
 public:
 
     mhj_impl(args output, function func, double eps_proc, double eps_opt, int n_count)
-        : N(output.n)
+        : n_count(n_count)
+        , eps_proc(eps_proc)
+        , eps_opt(eps_opt)
+        , t1(0.618033988749894)
+        , t2(1 - 0.618033988749894)
+        , d(1)
+        , a_m(-1)
+        , b_m(1)
+        , N(output.n)
         , x(output.vals)
         , func(func)
-        , n_count(n_count)
+        , pool(nullptr)
+        , probes(0)
+    {
+        _init();
+    }
+
+    /**
+     * Parallel exploration on the `pool`:
+     *
+     *  - the coordinate golden-section searches start from
+     *    the same base point and run concurrently; the step
+     *    takes the best (by the objective) of the combined
+     *    move, the best single coordinate move and no move;
+     *  - the pattern step evaluates `probes` equally spaced
+     *    points of the bracket at once and keeps the two
+     *    intervals around the best one.
+     *
+     * All reductions run in the index order with ties going
+     * to the lower index, so the result depends neither on
+     * the number of workers nor on the scheduling.
+     */
+    mhj_impl(args output, concurrent_function func, util::thread_pool & pool,
+             double eps_proc, double eps_opt, int n_count, size_t probes = 8)
+        : n_count(n_count)
         , eps_proc(eps_proc)
         , eps_opt(eps_opt)
         , t1(0.618033988749894)
         , t2(1 - 0.618033988749894)
+        , d(1)
         , a_m(-1)
         , b_m(1)
-        , d(1)
+        , N(output.n)
+        , x(output.vals)
+        , cfunc(func)
+        , pool(&pool)
+        , probes((probes < 2) ? 2 : probes)
+    {
+        points.resize(pool.size(), std::vector < double > (N));
+        delta.resize(N);
+        values.resize(((size_t) N + 1 > this->probes) ? (size_t) N + 1 : this->probes);
+        _init();
+    }
+
+private:
+
+    mhj_impl(const mhj_impl &);
+    mhj_impl & operator = (const mhj_impl &);
+
+    void _init()
     {
         y = new double[N];
         x1 = new double[N];
@@ -53,6 +124,8 @@ public:
         count = 0;
     }
 
+public:
+
     ~mhj_impl()
     {
         delete[] y;
@@ -63,6 +136,8 @@ public:
 
     bool step()
     {
+        if (pool != nullptr) return _parallel_step();
+
         count++;
         for (i = 0; i < N; i++)  x1[i] = x[i];
         //=======================================================
@@ -138,6 +213,108 @@ public:
             }
         } while ((b - a) > eps_opt);
 
+        lam = (a + b) / 2;
+        for (i = 0; i < N; i++)   y[i] = (double) (x[i] + lam*dl[i]);
+        return false;
+    }
+
+private:
+
+    /* golden-section search along the coordinate `k` from `y`,
+       stores the move to `delta[k]` and its value to `values[k]` */
+    void _coordinate(size_t k, size_t worker)
+    {
+        double * p = points[worker].data();
+        for (int j = 0; j < N; j++) p[j] = y[j];
+
+        double a = a_m, b = b_m;
+        double l = a + t2*(b - a), m = a + t1*(b - a);
+        p[k] = y[k] + l; double fl = cfunc(p, worker);
+        p[k] = y[k] + m; double fm = cfunc(p, worker);
+        do
+        {
+            if (fm < fl)
+            {
+                a = l;  l = m;  m = a + t1*(b - a); fl = fm;
+                p[k] = y[k] + m;
+                fm = cfunc(p, worker);
+            }
+            else
+            {
+                b = m;  m = l;  l = a + t2*(b - a); fm = fl;
+                p[k] = y[k] + l;
+                fl = cfunc(p, worker);
+            }
+        } while ((b - a) > eps_opt);
+
+        delta[k] = (a + b) / 2 * d;
+        p[k] = y[k] + delta[k];
+        values[k] = cfunc(p, worker);
+    }
+
+    /* the index of the least of `values[0 .. n)` */
+    size_t _argmin(size_t n) const
+    {
+        size_t best = 0;
+        for (size_t j = 1; j < n; j++) if (values[j] < values[best]) best = j;
+        return best;
+    }
+
+    bool _parallel_step()
+    {
+        count++;
+        for (i = 0; i < N; i++)  x1[i] = x[i];
+
+        /* the coordinate probes and the base point (task N) */
+        pool->run(N + 1, [&] (size_t t, size_t w)
+        {
+            if (t < (size_t) N) { _coordinate(t, w); return; }
+            for (int j = 0; j < N; j++) points[w][j] = y[j];
+            values[N] = cfunc(points[w].data(), w);
+        });
+
+        size_t best = _argmin(N);
+        double f_single = values[best], f_base = values[N];
+        for (i = 0; i < N; i++) y1[i] = y[i] + delta[i];
+        double f_combined = cfunc(y1, 0);
+        if ((f_combined <= f_single) && (f_combined <= f_base))
+        {
+            for (i = 0; i < N; i++) y[i] = y1[i];
+        }
+        else if (f_single < f_base)
+        {
+            y[best] += delta[best];
+        }
+
+        for (i = 0; i < N; i++)   x[i] = y[i];
+
+        s = 0.; ss = 0;
+        for (i = 0; i < N; i++)
+        {
+            s += (x1[i] - x[i])*(x1[i] - x[i]);
+            ss += x[i] * x[i];
+        }
+        if ((s < ss*eps_proc) || (count > n_count)) return true;
+
+        for (i = 0; i < N; i++)   dl[i] = x[i] - x1[i];
+
+        /* the pattern step: `probes` points of [a, b] at once */
+        a = 0; b = 1;
+        do
+        {
+            double h = (b - a) / (probes + 1), a0 = a;
+            pool->run(probes, [&] (size_t t, size_t w)
+            {
+                double lambda = a0 + h * (t + 1);
+                double * p = points[w].data();
+                for (int j = 0; j < N; j++) p[j] = x[j] + lambda*dl[j];
+                values[t] = cfunc(p, w);
+            });
+            size_t j = _argmin(probes);
+            a = a0 + h * j;
+            b = a0 + h * (j + 2);
+        } while ((b - a) > eps_opt);
+
         lam = (a + b) / 2;
         for (i = 0; i < N; i++)   y[i] = (double) (x[i] + lam*dl[i]);
         return false;
@@ -154,6 +331,7 @@ public:
 
     using args = mhj_impl::args;
     using function = mhj_impl::function;
+    using concurrent_function = mhj_impl::concurrent_function;
 
     static void mhj(function func, args output)
     {
@@ -161,6 +339,12 @@ public:
         while (!++m) {}
     }
 
+    static void mhj(concurrent_function func, args output, util::thread_pool & pool)
+    {
+        mhj_method m(func, output, pool);
+        while (!++m) {}
+    }
+
 private:
 
     function func;
@@ -181,6 +365,16 @@ public:
     {
     }
 
+    /* the parallel exploration, see `mhj_impl` */
+    mhj_method(concurrent_function func, args output, util::thread_pool & pool,
+               double eps_proc = 1e-6, double eps_opt = 1e-6, int n_count = 10000,
+               size_t probes = 8)
+        : current(output)
+        , complete(false)
+        , impl(output, func, pool, eps_proc, eps_opt, n_count, probes)
+    {
+    }
+
     mhj_method& operator ++()
     {
         complete = impl.step();
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/math/common.h>
+#include <util/common/math/simd.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                 dot product kernels               */
+    /*****************************************************/
+
+    /* `n` is a multiple of 4 in all the kernels */
+
+    inline double _poly_dot_scalar(const double * a, const double * b, size_t n)
+    {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (size_t i = 0; i < n; i += 4)
+        {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        return (s0 + s2) + (s1 + s3);
+    }
+
+#ifdef UTIL_SIMD_X86
+
+    UTIL_SIMD_TARGET("sse2")
+    inline double _poly_dot_sse2(const double * a, const double * b, size_t n)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        for (size_t i = 0; i < n; i += 4)
+        {
+            s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+        }
+        __m128d s = _mm_add_pd(s0, s1);
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+
+    UTIL_SIMD_TARGET("avx")
+    inline double _poly_dot_avx(const double * a, const double * b, size_t n)
+    {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+        }
+        if (i < n)
+        {
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        }
+        __m256d s = _mm256_add_pd(s0, s1);
+        __m128d h = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+        double r = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+        _mm256_zeroupper();
+        return r;
+    }
+
+#endif
+
+    /*****************************************************/
+    /*                 polyphase_filter                  */
+    /*****************************************************/
+
+    /**
+     * Streaming FIR filter with rational `up / down` rate
+     * change by the polyphase decomposition:
+     *
+     *      y[m] = sum_k h[k] u[m down - k],
+     *
+     * `u` being the input upsampled by `up` (zero-stuffed).
+     * Only the kept output samples are computed, each one is
+     * a single dot product of `taps_per_phase()` length
+     * against the input history. `up = 1` decimates,
+     * `down = 1` interpolates; the taps include the gain
+     * (`up` for the unity pass band, see `lowpass`).
+     *
+     * The input history and the phase persist between
+     * `process` calls, so a signal split into blocks of any
+     * size yields the same output as the whole one.
+     */
+    class polyphase_filter
+    {
+
+    private:
+
+        size_t l, m, j;
+        simd::level isa;
+
+        /* phase `p` taps reversed and zero-padded at the front
+           to `j`, a multiple of 4: phases[p * j + i] */
+        std::vector < double > phases;
+        /* the last `j - 1` inputs followed by the current block */
+        std::vector < double > work;
+        /* the upsampled time of the next output, relative
+           to the first sample of the next block */
+        size_t t;
+
+    public:
+
+        polyphase_filter(const double * taps, size_t n_taps,
+                         size_t up, size_t down,
+                         simd::level isa = simd::avx2)
+            : l(up)
+            , m(down)
+            , isa(simd::select(isa))
+            , t(0)
+        {
+            assert((up > 0) && (down > 0) && (n_taps > 0));
+            size_t per_phase = (n_taps + l - 1) / l;
+            j = (per_phase + 3) & ~(size_t) 3;
+            phases.assign(l * j, 0.);
+            for (size_t p = 0; p < l; ++p)
+            for (size_t q = 0; p + q * l < n_taps; ++q)
+            {
+                phases[p * j + (j - 1 - q)] = taps[p + q * l];
+            }
+            work.assign(j - 1, 0.);
+        }
+
+        /**
+         * Windowed-sinc (Blackman) low-pass for the `up / down`
+         * rate change: the cutoff is at the lower Nyquist
+         * frequency, the pass band gain is `up`;
+         * `2 zero_crossings max(up, down) + 1` taps.
+         */
+        static std::vector < double > lowpass(size_t up, size_t down, size_t zero_crossings = 8)
+        {
+            size_t r = (std::max)(up, down);
+            size_t n = 2 * zero_crossings * r + 1;
+            double c = (n - 1) / 2.;
+            std::vector < double > h(n);
+            for (size_t k = 0; k < n; ++k)
+            {
+                double x = (k - c) / r;
+                double sinc = (x == 0) ? 1 : std::sin(M_PI * x) / (M_PI * x);
+                double w = 0.42 - 0.5 * std::cos(2 * M_PI * k / (n - 1))
+                                + 0.08 * std::cos(4 * M_PI * k / (n - 1));
+                h[k] = (double) up / r * sinc * w;
+            }
+            return h;
+        }
+
+        size_t up() const { return l; }
+
+        size_t down() const { return m; }
+
+        size_t taps_per_phase() const { return j; }
+
+        /**
+         * The upper bound of the outputs `process`
+         * produces from `count` inputs.
+         */
+        size_t max_output(size_t count) const
+        {
+            return (count * l + m - 1) / m;
+        }
+
+        /**
+         * Filters the next block of the stream.
+         *
+         * Returns:
+         *      The number of output samples written
+         */
+        size_t process(const double * input, size_t count, double * output)
+        {
+            size_t h = j - 1;
+            work.resize(h + count);
+            std::copy(input, input + count, work.begin() + h);
+
+            size_t produced = 0;
+            const size_t end = count * l;
+            for (; t < end; t += m)
+            {
+                size_t p = t % l, n = t / l;
+                output[produced++] = _dot(&phases[p * j], &work[n]);
+            }
+            t -= end;
+
+            /* keep the history for the next block */
+            std::copy(work.end() - h, work.end(), work.begin());
+            work.resize(h);
+            return produced;
+        }
+
+        /**
+         * Filters the next block; `output.count` is the
+         * capacity on input and the number of written
+         * samples on return.
+         */
+        size_t process(const sampled_t & input, sampled_t & output)
+        {
+            assert(output.count >= max_output(input.count));
+            output.count = process(input.samples, input.count, output.samples);
+            output.period = input.period * m / l;
+            return output.count;
+        }
+
+        void reset()
+        {
+            work.assign(j - 1, 0.);
+            t = 0;
+        }
+
+    private:
+
+        double _dot(const double * a, const double * b) const
+        {
+        #ifdef UTIL_SIMD_X86
+            if (isa >= simd::avx) return _poly_dot_avx(a, b, j);
+            if (isa >= simd::sse2) return _poly_dot_sse2(a, b, j);
+        #endif
+            return _poly_dot_scalar(a, b, j);
+        }
+    };
+
+    /*****************************************************/
+    /*                  one-shot helpers                 */
+    /*****************************************************/
+
+    /**
+     * Resamples `input` by `up / down` with the `lowpass`
+     * filter; `output.count` is the capacity on input
+     * (at least `ceil(input.count up / down)`).
+     *
+     * Returns:
+     *      The number of output samples
+     */
+    inline size_t resample(sampled_t &input, sampled_t &output,
+                           size_t up, size_t down,
+                           size_t zero_crossings = 8)
+    {
+        std::vector < double > h = polyphase_filter::lowpass(up, down, zero_crossings);
+        polyphase_filter f(h.data(), h.size(), up, down);
+        return f.process(input, output);
+    }
+
+    inline size_t decimate(sampled_t &input, sampled_t &output, size_t factor,
+                           size_t zero_crossings = 8)
+    {
+        return resample(input, output, 1, factor, zero_crossings);
+    }
+
+    inline size_t interpolate(sampled_t &input, sampled_t &output, size_t factor,
+                              size_t zero_crossings = 8)
+    {
+        return resample(input, output, factor, 1, zero_crossings);
+    }
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/math/common.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                   ring_signal                     */
+    /*****************************************************/
+
+    /**
+     * Fixed-capacity sliding window over a sample stream
+     * with running statistics.
+     *
+     * `append` pushes a block of samples, evicting the oldest
+     * ones once the window is full, and updates the power and
+     * the autocorrelation sums for lags `[0, lags)` in
+     * O(block * lags). The sums are recomputed from scratch
+     * once per `capacity()` appended samples to bound the
+     * rounding drift, which adds O(lags) per sample amortized.
+     *
+     * The samples are stored twice (mirrored), so the window
+     * is always available as a contiguous `sampled_t` view
+     * for the functions in `common.h`.
+     */
+    class ring_signal
+    {
+
+    private:
+
+        size_t w, n_lags;
+        double period_;
+
+        std::vector < double > data;
+        /* global index of the oldest sample, number of samples */
+        size_t start, n;
+        size_t since_refresh;
+
+        double power_;
+        std::vector < double > acf;
+
+    public:
+
+        ring_signal(size_t capacity, double period, size_t lags = 1)
+            : w(capacity)
+            , n_lags(lags)
+            , period_(period)
+            , data(2 * capacity, 0.)
+            , start(0)
+            , n(0)
+            , since_refresh(0)
+            , power_(0)
+            , acf(lags, 0.)
+        {
+            assert(capacity > 0);
+        }
+
+        size_t capacity() const { return w; }
+
+        size_t size() const { return n; }
+
+        size_t lags() const { return n_lags; }
+
+        double period() const { return period_; }
+
+        bool full() const { return n == w; }
+
+        /**
+         * The `i`-th sample of the window, 0 is the oldest.
+         */
+        double operator [] (size_t i) const
+        {
+            assert(i < n);
+            return data[(start + i) % w];
+        }
+
+        /**
+         * Contiguous view of the window; valid until
+         * the next `append`.
+         */
+        sampled_t view()
+        {
+            sampled_t v = { data.data() + start % w, n, period_ };
+            return v;
+        }
+
+        void append(const double * samples, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (n == w) _evict();
+                _push(samples[i]);
+            }
+            since_refresh += count;
+            if (since_refresh >= w) _refresh();
+        }
+
+        void append(const sampled_t & block)
+        {
+            assert(abs(block.period - period_) < 1e-15);
+            append(block.samples, block.count);
+        }
+
+        void clear()
+        {
+            start = n = since_refresh = 0;
+            power_ = 0;
+            std::fill(acf.begin(), acf.end(), 0.);
+        }
+
+        /**
+         * The sum of the squared window samples, i.e.
+         * the power as returned by `sample` or `convolve`.
+         */
+        double power() const { return power_; }
+
+        /**
+         * Same as `autocorrelation(view(), output)`:
+         * `output.count <= lags()` and less than `size()`.
+         */
+        void autocorrelation(sampled_t & output) const
+        {
+            assert(output.count <= n_lags);
+            assert(n > output.count);
+            assert(abs(period_ - output.period) < 1e-15);
+            for (size_t k = 0; k < output.count; ++k)
+            {
+                output.samples[k] = acf[k] / (n - k);
+            }
+        }
+
+        /**
+         * The raw sum `sum_i x[i] x[i + lag]` over the window.
+         */
+        double autocorrelation_sum(size_t lag) const
+        {
+            assert(lag < n_lags);
+            return acf[lag];
+        }
+
+    private:
+
+        double _at(size_t g) const
+        {
+            return data[g % w];
+        }
+
+        void _push(double x)
+        {
+            size_t g = start + n;
+            data[g % w] = data[g % w + w] = x;
+            ++n;
+            size_t m = (std::min)(n_lags, n);
+            for (size_t k = 0; k < m; ++k) acf[k] += x * _at(g - k);
+            power_ += x * x;
+        }
+
+        void _evict()
+        {
+            double x = _at(start);
+            size_t m = (std::min)(n_lags, n);
+            for (size_t k = 0; k < m; ++k) acf[k] -= x * _at(start + k);
+            power_ -= x * x;
+            ++start;
+            --n;
+        }
+
+        void _refresh()
+        {
+            since_refresh = 0;
+            const double * x = data.data() + start % w;
+            power_ = 0;
+            for (size_t i = 0; i < n; ++i) power_ += x[i] * x[i];
+            for (size_t k = 0; k < n_lags; ++k)
+            {
+                double s = 0;
+                for (size_t i = k; i < n; ++i) s += x[i] * x[i - k];
+                acf[k] = s;
+            }
+        }
+    };
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/math/rpoly.h>
+#include <util/common/math/complex.h>
+#include <util/common/thread_pool.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                   rpoly_batch                     */
+    /*****************************************************/
+
+    /**
+     * Roots of many real polynomials of the same degree
+     * by `rpoly_context`, one context per worker, so the
+     * solves neither share state nor allocate after the
+     * first call.
+     *
+     * Layout, all row-major:
+     *      coefficients - `count x (degree + 1)`, decreasing
+     *                     powers (the `rpoly` order)
+     *      zeror, zeroi - `count x degree`; the slots of the
+     *                     roots not found are set to NaN
+     *      status       - `count` results of `rpoly`: `degree`
+     *                     if converged, less if the shifts
+     *                     failed, -1 if the leading
+     *                     coefficient is zero; may be null
+     *
+     * The result of each polynomial does not depend on the
+     * number of workers.
+     */
+    class rpoly_batch
+    {
+
+    private:
+
+        std::vector < rpoly_context > contexts;
+
+    public:
+
+        /* polynomials per thread pool task */
+        static size_t chunk_size() { return 256; }
+
+        /**
+         * Returns:
+         *      the number of polynomials with all
+         *      the roots found
+         */
+        size_t solve(const double * coefficients, size_t count, int degree,
+                     double * zeror, double * zeroi, int * status = nullptr)
+        {
+            if (contexts.empty()) contexts.resize(1);
+            return _solve(coefficients, 0, count, degree, zeror, zeroi, status, contexts[0]);
+        }
+
+        size_t solve(const double * coefficients, size_t count, int degree,
+                     double * zeror, double * zeroi, int * status,
+                     util::thread_pool & pool)
+        {
+            if (contexts.size() < pool.size()) contexts.resize(pool.size());
+            size_t tasks = (count + chunk_size() - 1) / chunk_size();
+            std::vector < size_t > solved(tasks);
+            pool.run(tasks, [&] (size_t t, size_t w)
+            {
+                size_t from = t * chunk_size(), to = (std::min)(count, from + chunk_size());
+                solved[t] = _solve(coefficients, from, to, degree, zeror, zeroi, status, contexts[w]);
+            });
+            size_t total = 0;
+            for (size_t t = 0; t < tasks; ++t) total += solved[t];
+            return total;
+        }
+
+    private:
+
+        static size_t _solve(const double * coefficients, size_t from, size_t to, int degree,
+                             double * zeror, double * zeroi, int * status,
+                             rpoly_context & context)
+        {
+            assert(degree > 0);
+            const double nan = std::numeric_limits < double > ::quiet_NaN();
+            size_t solved = 0;
+            for (size_t q = from; q < to; ++q)
+            {
+                double * zr = zeror + q * degree, * zi = zeroi + q * degree;
+                int found = context.solve(coefficients + q * (degree + 1), degree, zr, zi);
+                for (int i = (std::max)(found, 0); i < degree; ++i) zr[i] = zi[i] = nan;
+                if (status != nullptr) status[q] = found;
+                if (found == degree) ++solved;
+            }
+            return solved;
+        }
+    };
+
+    /*****************************************************/
+    /*                   root_tracker                    */
+    /*****************************************************/
+
+    /**
+     * Roots of a sequence of slowly varying real polynomials
+     * of the same degree (a parameter sweep) by continuation:
+     * the roots of the previous step are the initial guesses
+     * of the simultaneous Aberth-Ehrlich iteration
+     *
+     *      w_i = N_i / (1 - N_i sum_{j != i} 1 / (z_i - z_j)),
+     *      N_i = p(z_i) / p'(z_i),
+     *
+     * followed by a Newton polishing step. It converges in
+     * a few iterations when the steps are small; Jenkins-Traub
+     * (`rpoly_context`) starts from scratch only on the first
+     * step, on a degree change and when the tracking fails:
+     * no convergence in `max_iterations`, a non-finite iterate
+     * or colliding roots (e.g. near a multiple root).
+     *
+     * The i-th root continues the i-th root of the previous
+     * step, the fallback roots are matched to the previous
+     * ones by proximity, so the branches stay continuous.
+     */
+    class root_tracker
+    {
+
+    private:
+
+        int degree;
+        int max_iterations;
+        double tolerance;
+        rpoly_context context;
+
+        std::vector < complex < > > z, w;
+        std::vector < double > zr, zi;
+        std::vector < char > done, used;
+        bool tracking;
+
+        size_t n_tracked, n_fallbacks;
+
+    public:
+
+        /**
+         * Parameters:
+         *      max_iterations - the Aberth iteration limit
+         *                       before the fallback
+         *      tolerance      - the relative correction of
+         *                       a converged root
+         */
+        root_tracker(int max_iterations = 30, double tolerance = 1e-12)
+            : degree(0)
+            , max_iterations(max_iterations)
+            , tolerance(tolerance)
+            , tracking(false)
+            , n_tracked(0)
+            , n_fallbacks(0)
+        {
+        }
+
+        /**
+         * The roots of the next polynomial of the sweep,
+         * `rpoly` conventions.
+         *
+         * Returns:
+         *      the number of roots found, -1 if the leading
+         *      coefficient is zero
+         */
+        int solve(const double * op, int degree, double * zeror, double * zeroi)
+        {
+            assert(degree > 0);
+            if (op[0] == 0)
+            {
+                reset();
+                return -1;
+            }
+            if (tracking && (degree == this->degree) && _track(op))
+            {
+                ++n_tracked;
+            }
+            else
+            {
+                ++n_fallbacks;
+                int found = _fallback(op, degree);
+                if (found != degree)
+                {
+                    for (int i = 0; i < found; ++i) { zeror[i] = zr[i]; zeroi[i] = zi[i]; }
+                    tracking = false;
+                    return found;
+                }
+            }
+            for (int i = 0; i < degree; ++i) { zeror[i] = z[i].re; zeroi[i] = z[i].im; }
+            return degree;
+        }
+
+        /* forgets the roots, the next step starts from scratch */
+        void reset() { tracking = false; }
+
+        /* steps solved by the continuation */
+        size_t tracked() const { return n_tracked; }
+        /* steps solved by Jenkins-Traub */
+        size_t fallbacks() const { return n_fallbacks; }
+
+    private:
+
+        /* p(x) and p'(x) by the Horner scheme, `bound` is
+           sum |a_k| |x|^k for the rounding error estimate */
+        void _horner(const double * op, const complex < > & x,
+                     complex < > & p, complex < > & dp, double & bound) const
+        {
+            double r = norm(x);
+            p = { op[0], 0 };
+            dp = { 0, 0 };
+            bound = std::abs(op[0]);
+            for (int k = 1; k <= degree; ++k)
+            {
+                dp = dp * x + p;
+                p = p * x + op[k];
+                bound = bound * r + std::abs(op[k]);
+            }
+        }
+
+        /* the iteration updates `z` in place; on failure `z`
+           is restored from the snapshot in `w`, so that the
+           fallback matches the previous step's roots rather
+           than the failed iterates */
+        bool _track(const double * op)
+        {
+            w.assign(z.begin(), z.end());
+            if (_iterate(op)) return true;
+            z.swap(w);
+            return false;
+        }
+
+        bool _iterate(const double * op)
+        {
+            const double eps = std::numeric_limits < double > ::epsilon();
+            done.assign(degree, 0);
+            int remaining = degree;
+            for (int it = 0; (it < max_iterations) && (remaining > 0); ++it)
+            {
+                for (int i = 0; i < degree; ++i)
+                {
+                    if (done[i]) continue;
+                    complex < > p, dp;
+                    double bound;
+                    _horner(op, z[i], p, dp, bound);
+                    if (norm(p) <= 4 * degree * eps * bound)
+                    {
+                        done[i] = 1; --remaining;
+                        continue;
+                    }
+                    complex < > s = { 0, 0 };
+                    for (int j = 0; j < degree; ++j)
+                    {
+                        if (j == i) continue;
+                        complex < > d = z[i] - z[j];
+                        if (sqnorm(d) == 0) return false;
+                        s = s + 1. / d;
+                    }
+                    complex < > newton = p / dp;
+                    complex < > step = newton / (1. - newton * s);
+                    if (!std::isfinite(step.re) || !std::isfinite(step.im)) return false;
+                    z[i] = z[i] - step;
+                    if (norm(step) <= tolerance * norm(z[i]))
+                    {
+                        done[i] = 1; --remaining;
+                    }
+                }
+            }
+            if (remaining > 0) return false;
+
+            /* Newton polishing; conjugate pairs and real roots
+               are restored where the imaginary part is noise */
+            double scale = 0;
+            for (int i = 0; i < degree; ++i)
+            {
+                complex < > p, dp;
+                double bound;
+                _horner(op, z[i], p, dp, bound);
+                if (sqnorm(dp) != 0)
+                {
+                    complex < > step = p / dp;
+                    if (std::isfinite(step.re) && std::isfinite(step.im)) z[i] = z[i] - step;
+                }
+                if (std::abs(z[i].im) <= 4 * tolerance * norm(z[i])) z[i].im = 0;
+                scale = (std::max)(scale, norm(z[i]));
+            }
+            for (int i = 0; i < degree; ++i)
+            for (int j = i + 1; j < degree; ++j)
+            {
+                if (norm(z[i] - z[j]) <= tolerance * scale) return false;
+            }
+            return true;
+        }
+
+        int _fallback(const double * op, int degree)
+        {
+            zr.resize(degree);
+            zi.resize(degree);
+            int found = context.solve(op, degree, zr.data(), zi.data());
+            if (found != degree) return found;
+
+            w.resize(degree);
+            if (tracking && (degree == this->degree))
+            {
+                /* continue each previous root by the nearest one */
+                used.assign(degree, 0);
+                for (int i = 0; i < degree; ++i)
+                {
+                    int best = -1;
+                    double best_d = 0;
+                    for (int j = 0; j < degree; ++j)
+                    {
+                        if (used[j]) continue;
+                        complex < > c = { zr[j], zi[j] };
+                        double d = sqnorm(c - z[i]);
+                        if ((best < 0) || (d < best_d)) { best = j; best_d = d; }
+                    }
+                    used[best] = 1;
+                    w[i] = { zr[best], zi[best] };
+                }
+            }
+            else
+            {
+                for (int i = 0; i < degree; ++i) w[i] = { zr[i], zi[i] };
+            }
+            z.swap(w);
+            this->degree = degree;
+            tracking = true;
+            return found;
+        }
+    };
+}
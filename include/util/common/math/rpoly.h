@@ -32,4 +32,50 @@
 #include <math.h>
 #include <stdlib.h>
 
-int rpoly(double *op, int degree, double *zeror, double *zeroi);
\ No newline at end of file
+#include <vector>
+
+int rpoly(double *op, int degree, double *zeror, double *zeroi);
+
+/*
+ *      rpoly_context -- the solver state of rpoly.
+ *
+ *      Owns everything rpoly kept in file-scope globals, so
+ *      independent solves may run concurrently on separate
+ *      contexts. The working vectors live in a buffer that
+ *      only grows: repeated solves of the same (or lower)
+ *      degree on one context do not allocate.
+ *
+ *      solve() has the rpoly calling conventions; rpoly()
+ *      solves on a temporary context.
+ */
+class rpoly_context
+{
+
+public:
+
+    rpoly_context();
+
+    int solve(const double *op, int degree, double *zeror, double *zeroi);
+
+    /* the number of iterations of the last solve over all
+       its zeros, 0 if it returned before iterating */
+    int iterations() const { return itercnt; }
+
+private:
+
+    std::vector < double > buffer;
+
+    double *p,*qp,*k,*qk,*svk;
+    double sr,si,u,v,a,b,c,d,a1;
+    double a3,a7,e,f,g,h,szr,szi,lzr,lzi;
+    double eta,are,mre;
+    int n;
+    int itercnt;
+
+    void fxshfr(int l2, int *nz);
+    void quadit(double *uu,double *vv,int *nz);
+    void realit(double sss, int *nz, int *iflag);
+    void calcsc(int *type);
+    void nextk(int *type);
+    void newest(int type,double *uu,double *vv);
+};
\ No newline at end of file
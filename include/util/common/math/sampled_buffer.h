@@ -0,0 +1,348 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _MSC_VER
+    #include <malloc.h>
+#endif
+
+#include <util/common/math/common.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                   sample_pool                     */
+    /*****************************************************/
+
+    /**
+     * Cache of 64-byte aligned sample blocks grouped into
+     * power-of-two size classes (64 samples minimum).
+     *
+     * Released blocks are kept in the per-class free lists
+     * and handed out again, so a processing loop that
+     * allocates and frees the same sizes every frame hits
+     * the heap during the first iteration only. `trim()`
+     * returns the cached blocks to the heap.
+     *
+     * All the operations are thread-safe. The blocks must
+     * be released to the pool they were acquired from and
+     * before the pool is destroyed.
+     */
+    class sample_pool
+    {
+
+    public:
+
+        static const size_t alignment = 64;
+        static const size_t min_capacity = 64;
+
+    private:
+
+        struct size_class
+        {
+            /* cached blocks */
+            std::vector < double * > free;
+            /* blocks obtained from the heap */
+            size_t blocks;
+        };
+
+        std::mutex mutex;
+        std::vector < size_class > classes;
+
+    public:
+
+        sample_pool()
+        {
+        }
+
+        ~sample_pool()
+        {
+            trim();
+        }
+
+        /**
+         * The process-wide pool used by `sampled_buffer`
+         * by default.
+         */
+        static sample_pool & global();
+
+        /**
+         * Returns an aligned block of at least `count` samples
+         * and stores its actual size into `capacity`.
+         */
+        double * acquire(size_t count, size_t & capacity)
+        {
+            size_t c = _size_class(count);
+            capacity = min_capacity << c;
+            {
+                std::lock_guard < std::mutex > lock(mutex);
+                if (c >= classes.size())
+                {
+                    size_class empty = { std::vector < double * > (), 0 };
+                    classes.resize(c + 1, empty);
+                }
+                if (!classes[c].free.empty())
+                {
+                    double * p = classes[c].free.back();
+                    classes[c].free.pop_back();
+                    return p;
+                }
+            }
+            double * p = _allocate(capacity);
+            if (p == nullptr) throw std::bad_alloc();
+            std::lock_guard < std::mutex > lock(mutex);
+            try
+            {
+                /* the free list is able to hold every block
+                   of the class, so `release` never allocates */
+                classes[c].free.reserve(classes[c].blocks + 1);
+            }
+            catch (...)
+            {
+                _free(p);
+                throw;
+            }
+            ++classes[c].blocks;
+            return p;
+        }
+
+        void release(double * p, size_t capacity)
+        {
+            if (p == nullptr) return;
+            size_t c = _size_class(capacity);
+            assert((min_capacity << c) == capacity);
+            std::lock_guard < std::mutex > lock(mutex);
+            classes[c].free.push_back(p);
+        }
+
+        /**
+         * Returns all the cached blocks to the heap.
+         */
+        void trim()
+        {
+            std::lock_guard < std::mutex > lock(mutex);
+            for (size_t c = 0; c < classes.size(); ++c)
+            {
+                for (size_t i = 0; i < classes[c].free.size(); ++i)
+                {
+                    _free(classes[c].free[i]);
+                }
+                classes[c].blocks -= classes[c].free.size();
+                classes[c].free.clear();
+            }
+        }
+
+        /**
+         * The number of blocks currently obtained from
+         * the heap, both cached and in use.
+         */
+        size_t heap_block_count()
+        {
+            std::lock_guard < std::mutex > lock(mutex);
+            size_t n = 0;
+            for (size_t c = 0; c < classes.size(); ++c) n += classes[c].blocks;
+            return n;
+        }
+
+    private:
+
+        sample_pool(const sample_pool &);
+        sample_pool & operator = (const sample_pool &);
+
+        static size_t _size_class(size_t count)
+        {
+            size_t c = 0;
+            while ((min_capacity << c) < count) ++c;
+            return c;
+        }
+
+        static double * _allocate(size_t count)
+        {
+#ifdef _MSC_VER
+            return (double *) _aligned_malloc(count * sizeof(double), alignment);
+#else
+            void * p = nullptr;
+            if (posix_memalign(&p, alignment, count * sizeof(double)) != 0) return nullptr;
+            return (double *) p;
+#endif
+        }
+
+        static void _free(double * p)
+        {
+#ifdef _MSC_VER
+            _aligned_free(p);
+#else
+            free(p);
+#endif
+        }
+    };
+
+    template < typename _dummy_t = void >
+    struct _sample_pool_instance
+    {
+        static sample_pool pool;
+    };
+
+    template < typename _dummy_t >
+    sample_pool _sample_pool_instance < _dummy_t > ::pool;
+
+    inline sample_pool & sample_pool::global()
+    {
+        return _sample_pool_instance < > ::pool;
+    }
+
+    /*****************************************************/
+    /*                  sampled_buffer                   */
+    /*****************************************************/
+
+    /**
+     * Owning, 64-byte aligned storage of a sampled signal
+     * backed by a `sample_pool`.
+     *
+     * Converts to the legacy `sampled_t` view, so it may be
+     * passed directly to the functions in `common.h`:
+     *
+     *      sampled_buffer f(n, dt), g(n, dt), fg(n, dt);
+     *      convolve(f, g, fg);
+     *
+     * As with plain `sampled_t`, the inputs and the output of
+     * such functions must not overlap.
+     *
+     * Replaces `allocate_sampled` / `free_sampled`: the block
+     * is returned to the pool on destruction. Movable,
+     * non-copyable.
+     */
+    class sampled_buffer
+    {
+
+    private:
+
+        sample_pool * pool;
+        size_t capacity_;
+        sampled_t view_;
+
+    public:
+
+        sampled_buffer()
+            : pool(nullptr)
+            , capacity_(0)
+        {
+            view_.samples = nullptr;
+            view_.count = 0;
+            view_.period = 0;
+        }
+
+        /**
+         * Same as `allocate_sampled(count, period)`.
+         */
+        sampled_buffer(size_t count, double period,
+                       sample_pool & pool = sample_pool::global())
+            : pool(&pool)
+        {
+            view_.samples = pool.acquire(count, capacity_);
+            view_.count = count;
+            view_.period = period;
+        }
+
+        /**
+         * Same as `allocate_sampled(size, count, period)`.
+         */
+        sampled_buffer(size_t size, size_t count, double period,
+                       sample_pool & pool = sample_pool::global())
+            : pool(&pool)
+        {
+            assert(count <= size);
+            view_.samples = pool.acquire(size, capacity_);
+            view_.count = count;
+            view_.period = period;
+        }
+
+        sampled_buffer(sampled_buffer && other)
+            : pool(other.pool)
+            , capacity_(other.capacity_)
+            , view_(other.view_)
+        {
+            other._detach();
+        }
+
+        sampled_buffer & operator = (sampled_buffer && other)
+        {
+            if (this != &other)
+            {
+                _release();
+                pool = other.pool;
+                capacity_ = other.capacity_;
+                view_ = other.view_;
+                other._detach();
+            }
+            return *this;
+        }
+
+        ~sampled_buffer()
+        {
+            _release();
+        }
+
+        operator sampled_t & () { return view_; }
+        operator const sampled_t & () const { return view_; }
+
+        sampled_t & view() { return view_; }
+        const sampled_t & view() const { return view_; }
+
+        double * samples() const { return view_.samples; }
+        size_t count() const { return view_.count; }
+        double period() const { return view_.period; }
+        size_t capacity() const { return capacity_; }
+
+        double & operator [] (size_t i) { return view_.samples[i]; }
+        double operator [] (size_t i) const { return view_.samples[i]; }
+
+        /**
+         * Changes the sample count; the samples are
+         * preserved, the storage is reacquired only
+         * if `count` exceeds the capacity.
+         */
+        void resize(size_t count)
+        {
+            if (count > capacity_)
+            {
+                sample_pool * p = (pool == nullptr) ? &sample_pool::global() : pool;
+                size_t capacity;
+                double * samples = p->acquire(count, capacity);
+                if (view_.samples != nullptr)
+                {
+                    std::copy(view_.samples, view_.samples + view_.count, samples);
+                }
+                _release();
+                pool = p;
+                capacity_ = capacity;
+                view_.samples = samples;
+            }
+            view_.count = count;
+        }
+
+    private:
+
+        sampled_buffer(const sampled_buffer &);
+        sampled_buffer & operator = (const sampled_buffer &);
+
+        void _release()
+        {
+            if (pool != nullptr) pool->release(view_.samples, capacity_);
+        }
+
+        void _detach()
+        {
+            pool = nullptr;
+            capacity_ = 0;
+            view_.samples = nullptr;
+            view_.count = 0;
+        }
+    };
+}
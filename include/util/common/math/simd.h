@@ -0,0 +1,109 @@
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define UTIL_SIMD_X86
+#endif
+
+#ifdef UTIL_SIMD_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+    #include <immintrin.h>
+#endif
+
+/* GCC and Clang only emit the instructions of the extensions
+   enabled for the function; MSVC allows any intrinsic anywhere */
+#if defined(UTIL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define UTIL_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define UTIL_SIMD_TARGET(isa)
+#endif
+
+namespace math
+{
+
+    namespace simd
+    {
+
+        /*****************************************************/
+        /*                  instruction sets                 */
+        /*****************************************************/
+
+        /**
+         * Instruction set extensions, each one
+         * implies all the previous ones.
+         */
+        enum level
+        {
+            scalar = 0,
+            sse2   = 1,
+            avx    = 2,
+            avx2   = 3
+        };
+
+    #ifdef UTIL_SIMD_X86
+
+        inline void _cpuid(int regs[4], int leaf, int subleaf)
+        {
+        #if defined(_MSC_VER)
+            __cpuidex(regs, leaf, subleaf);
+        #else
+            unsigned int a, b, c, d;
+            __cpuid_count(leaf, subleaf, a, b, c, d);
+            regs[0] = (int) a; regs[1] = (int) b; regs[2] = (int) c; regs[3] = (int) d;
+        #endif
+        }
+
+        inline unsigned long long _xgetbv0()
+        {
+        #if defined(_MSC_VER)
+            return _xgetbv(0);
+        #else
+            unsigned int a, d;
+            __asm__ ("xgetbv" : "=a" (a), "=d" (d) : "c" (0));
+            return ((unsigned long long) d << 32) | a;
+        #endif
+        }
+
+    #endif
+
+        /**
+         * Queries the CPU (and the OS, for AVX state saving)
+         * for the best supported instruction set.
+         */
+        inline level detect()
+        {
+        #ifdef UTIL_SIMD_X86
+            int regs[4];
+            _cpuid(regs, 0, 0);
+            int max_leaf = regs[0];
+            if (max_leaf < 1) return scalar;
+
+            _cpuid(regs, 1, 0);
+            if ((regs[3] & (1 << 26)) == 0) return scalar;
+
+            bool osxsave = (regs[2] & (1 << 27)) != 0;
+            bool has_avx = (regs[2] & (1 << 28)) != 0;
+            if (!osxsave || !has_avx || ((_xgetbv0() & 6) != 6)) return sse2;
+
+            if (max_leaf < 7) return avx;
+            _cpuid(regs, 7, 0);
+            return ((regs[1] & (1 << 5)) != 0) ? avx2 : avx;
+        #else
+            return scalar;
+        #endif
+        }
+
+        /**
+         * Limits the `requested` instruction set
+         * to the one supported by the CPU.
+         */
+        inline level select(level requested)
+        {
+            level supported = detect();
+            return (requested < supported) ? requested : supported;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/thread_pool.h>
+#include <util/common/math/common.h>
+
+namespace math
+{
+
+    inline size_t parallel_sort_threshold()
+    {
+        return (size_t) 1 << 15;
+    }
+
+    /**
+     * Parallel `sort_all`: the key/position pairs are sorted
+     * in `pool.size()` chunks, the sorted runs are merged
+     * pairwise (so the stable mode stays stable) and every
+     * array is gathered by chunks. Falls back to the serial
+     * version below `parallel_sort_threshold()` elements.
+     *
+     * Parameters:
+     *      order  - positive for ascending, negative for
+     *               descending; 0 leaves the arrays as is
+     *      stable - keep the relative order of equal keys
+     */
+    inline void sort_all(double **arrays, size_t n_arrays, size_t n_elements,
+                         util::thread_pool &pool,
+                         int order = 1 /* lower */, bool stable = false)
+    {
+        assert(n_arrays > 0);
+        if (order == 0) return;
+        size_t chunks = pool.size();
+        if ((chunks < 2) || (n_elements < parallel_sort_threshold()))
+        {
+            sort_all(arrays, n_arrays, n_elements, order, stable);
+            return;
+        }
+
+        std::vector < size_t > bounds(chunks + 1);
+        for (size_t c = 0; c <= chunks; ++c) bounds[c] = n_elements * c / chunks;
+
+        std::vector < _sort_entry_t > entries(n_elements), merged(n_elements);
+        pool.run(chunks, [&] (size_t c, size_t)
+        {
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                entries[i] = _sort_entry_t(arrays[0][i], i);
+            }
+            _sort_entries(entries.begin() + bounds[c], entries.begin() + bounds[c + 1], order, stable);
+        });
+
+        /* merge adjacent runs until one is left */
+        auto less = (order > 0) ? &_sort_ascending : &_sort_descending;
+        std::vector < size_t > runs(bounds);
+        while (runs.size() > 2)
+        {
+            size_t n_runs = runs.size() - 1;
+            pool.run((n_runs + 1) / 2, [&] (size_t t, size_t)
+            {
+                size_t b0 = runs[2 * t], b1 = runs[(std::min)(2 * t + 1, n_runs)];
+                size_t b2 = runs[(std::min)(2 * t + 2, n_runs)];
+                std::merge(entries.begin() + b0, entries.begin() + b1,
+                           entries.begin() + b1, entries.begin() + b2,
+                           merged.begin() + b0, less);
+            });
+            std::vector < size_t > next;
+            for (size_t r = 0; r <= n_runs; r += 2) next.push_back(runs[r]);
+            if (next.back() != n_elements) next.push_back(n_elements);
+            runs.swap(next);
+            entries.swap(merged);
+        }
+
+        std::vector < double > buffer(n_elements);
+        pool.run(chunks, [&] (size_t c, size_t)
+        {
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i) arrays[0][i] = entries[i].first;
+        });
+        for (size_t k = 1; k < n_arrays; ++k)
+        {
+            /* the gather reads the whole array, so the
+               copy back waits for all the chunks */
+            pool.run(chunks, [&] (size_t c, size_t)
+            {
+                _gather_sorted(arrays, k, entries, bounds[c], bounds[c + 1], buffer.data());
+            });
+            pool.run(chunks, [&] (size_t c, size_t)
+            {
+                std::copy(buffer.begin() + bounds[c], buffer.begin() + bounds[c + 1], arrays[k] + bounds[c]);
+            });
+        }
+    }
+}
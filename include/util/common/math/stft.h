@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/thread_pool.h>
+#include <util/common/math/common.h>
+#include <util/common/math/complex.h>
+#include <util/common/math/fft.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                     windows                       */
+    /*****************************************************/
+
+    enum window_type
+    {
+        rectangular_window,
+        hann_window,
+        hamming_window,
+        blackman_harris_window
+    };
+
+    /**
+     * Periodic (DFT-even) window of `n` samples,
+     * as used for spectral analysis.
+     */
+    inline std::vector < double > make_window(window_type type, size_t n)
+    {
+        std::vector < double > w(n, 1.);
+        for (size_t i = 0; i < n; ++i)
+        {
+            double x = 2 * M_PI * i / n;
+            switch (type)
+            {
+            case hann_window:
+                w[i] = 0.5 - 0.5 * std::cos(x);
+                break;
+            case hamming_window:
+                w[i] = 0.54 - 0.46 * std::cos(x);
+                break;
+            case blackman_harris_window:
+                w[i] = 0.35875 - 0.48829 * std::cos(x)
+                     + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+                break;
+            default:
+                break;
+            }
+        }
+        return w;
+    }
+
+    enum welch_average
+    {
+        mean_average,
+        /* robust to transients, bias-corrected */
+        median_average
+    };
+
+    /*****************************************************/
+    /*                    stft_plan                      */
+    /*****************************************************/
+
+    /**
+     * Short-time Fourier transform and Welch power spectral
+     * density of real signals.
+     *
+     * Segments of `segment_size()` samples, `hop()` apart,
+     * are windowed and transformed by one shared real FFT
+     * plan; the per-worker segment and spectrum buffers are
+     * kept between the calls, so repeated analyses do not
+     * allocate. With a `thread_pool` the segments are
+     * distributed over the workers, the results do not
+     * depend on the number of workers.
+     *
+     * The power outputs are one-sided densities,
+     * `|X|^2 / (fs sum w^2)` doubled except at DC and Nyquist,
+     * so that the spectrogram rows average to the Welch PSD.
+     */
+    class stft_plan
+    {
+
+    private:
+
+        struct workspace
+        {
+            std::vector < double > segment;
+            std::vector < complex < > > spectrum, scratch;
+        };
+
+        size_t n, hop_;
+        std::vector < double > window;
+        double window_power;
+        rfft_plan plan;
+
+        std::vector < workspace > workspaces;
+        std::vector < double > partial, frames_buffer, column;
+
+    public:
+
+        /**
+         * `segment` - even number of samples per segment
+         * `overlap` - samples shared by adjacent segments
+         */
+        stft_plan(size_t segment, size_t overlap,
+                  window_type type = hann_window,
+                  simd::level isa = simd::avx2)
+            : n(segment)
+            , hop_(segment - overlap)
+            , window(make_window(type, segment))
+            , window_power(0)
+            , plan(segment, -1, isa)
+        {
+            assert((segment % 2 == 0) && (overlap < segment));
+            for (size_t i = 0; i < n; ++i) window_power += window[i] * window[i];
+        }
+
+        size_t segment_size() const { return n; }
+
+        size_t hop() const { return hop_; }
+
+        size_t overlap() const { return n - hop_; }
+
+        size_t bins() const { return n / 2 + 1; }
+
+        const std::vector < double > & get_window() const { return window; }
+
+        /**
+         * The number of whole segments in `count` samples.
+         */
+        size_t frame_count(size_t count) const
+        {
+            return (count < n) ? 0 : (1 + (count - n) / hop_);
+        }
+
+        /**
+         * Complex STFT: `frame_count(input.count)` rows of
+         * `bins()` windowed, unnormalized spectra.
+         */
+        void transform(const sampled_t & input, complex < > * output)
+        {
+            _transform(input, output, nullptr);
+        }
+
+        void transform(const sampled_t & input, complex < > * output, util::thread_pool & pool)
+        {
+            _transform(input, output, &pool);
+        }
+
+        /**
+         * Power spectrogram into the preallocated `output`:
+         * at least `frame_count(input.count)` rows of `bins()`
+         * samples. Sets the actual rows, the frame step and
+         * the frequency step; `grid_row(output, i)` is then
+         * the PSD of the `i`-th segment.
+         */
+        void spectrogram(const sampled_t & input, sampled_grid_t & output)
+        {
+            _spectrogram(input, output, nullptr);
+        }
+
+        void spectrogram(const sampled_t & input, sampled_grid_t & output, util::thread_pool & pool)
+        {
+            _spectrogram(input, output, &pool);
+        }
+
+        /**
+         * Welch PSD into `psd` (at least `bins()` samples);
+         * `psd.period` is set to the frequency step.
+         */
+        void welch(const sampled_t & input, sampled_t & psd,
+                   welch_average average = mean_average)
+        {
+            _welch(input, psd, average, nullptr);
+        }
+
+        void welch(const sampled_t & input, sampled_t & psd,
+                   util::thread_pool & pool, welch_average average = mean_average)
+        {
+            _welch(input, psd, average, &pool);
+        }
+
+    private:
+
+        stft_plan(const stft_plan &);
+        stft_plan & operator = (const stft_plan &);
+
+        template < typename _fn_t >
+        void _run(size_t tasks, util::thread_pool * pool, const _fn_t & fn)
+        {
+            size_t workers = (pool == nullptr) ? 1 : pool->size();
+            if (workspaces.size() < workers) workspaces.resize(workers);
+            for (size_t w = 0; w < workers; ++w)
+            {
+                workspaces[w].segment.resize(n);
+                workspaces[w].spectrum.resize(bins());
+                workspaces[w].scratch.resize(plan.scratch_size());
+            }
+            if (pool == nullptr)
+            {
+                for (size_t t = 0; t < tasks; ++t) fn(t, workspaces[0]);
+                return;
+            }
+            pool->run(tasks, [&] (size_t t, size_t w) { fn(t, workspaces[w]); });
+        }
+
+        /* windows and transforms the `frame`-th segment */
+        void _frame(const sampled_t & input, size_t frame, workspace & ws) const
+        {
+            const double * x = input.samples + frame * hop_;
+            for (size_t i = 0; i < n; ++i) ws.segment[i] = x[i] * window[i];
+            plan.execute(ws.segment.data(), ws.spectrum.data(), ws.scratch.data());
+        }
+
+        /* the one-sided density of `ws.spectrum` */
+        void _density(const workspace & ws, double fs, double * out) const
+        {
+            double scale = 1 / (fs * window_power);
+            size_t m = bins();
+            for (size_t k = 0; k < m; ++k)
+            {
+                double p = sqnorm(ws.spectrum[k]) * scale;
+                out[k] = ((k == 0) || (k == m - 1)) ? p : 2 * p;
+            }
+        }
+
+        void _transform(const sampled_t & input, complex < > * output, util::thread_pool * pool)
+        {
+            size_t m = bins();
+            _run(frame_count(input.count), pool, [&] (size_t f, workspace & ws)
+            {
+                _frame(input, f, ws);
+                std::copy(ws.spectrum.begin(), ws.spectrum.end(), output + f * m);
+            });
+        }
+
+        void _spectrogram(const sampled_t & input, sampled_grid_t & output, util::thread_pool * pool)
+        {
+            size_t frames = frame_count(input.count), m = bins();
+            assert(output.rows >= frames);
+            assert(output.cols == m);
+            double fs = 1 / input.period;
+            _run(frames, pool, [&] (size_t f, workspace & ws)
+            {
+                _frame(input, f, ws);
+                _density(ws, fs, output.samples + f * m);
+            });
+            output.rows = frames;
+            output.row_period = hop_ * input.period;
+            output.col_period = fs / n;
+        }
+
+        void _welch(const sampled_t & input, sampled_t & psd,
+                    welch_average average, util::thread_pool * pool)
+        {
+            size_t frames = frame_count(input.count), m = bins();
+            assert(frames > 0);
+            assert(psd.count >= m);
+            double fs = 1 / input.period;
+            psd.count = m;
+            psd.period = fs / n;
+
+            if (average == median_average)
+            {
+                frames_buffer.resize(frames * m);
+                sampled_grid_t grid = { frames_buffer.data(), frames, m, 0, 0 };
+                _spectrogram(input, grid, pool);
+                column.resize(frames);
+                /* the median of chi^2 with 2 dof is biased by ln 2
+                   asymptotically; exact factor for `frames` samples */
+                double bias = 1;
+                for (size_t i = 2; i + 1 <= frames; i += 2) bias += 1. / (i + 1) - 1. / i;
+                for (size_t k = 0; k < m; ++k)
+                {
+                    for (size_t f = 0; f < frames; ++f) column[f] = frames_buffer[f * m + k];
+                    std::nth_element(column.begin(), column.begin() + frames / 2, column.end());
+                    double median = column[frames / 2];
+                    if (frames % 2 == 0)
+                    {
+                        median = (median + *std::max_element(column.begin(), column.begin() + frames / 2)) / 2;
+                    }
+                    psd.samples[k] = median / bias;
+                }
+                return;
+            }
+
+            /* a fixed split of the frames keeps the summation
+               order independent of the number of workers */
+            size_t chunks = (std::min)(frames, (size_t) 64);
+            partial.assign(chunks * m, 0.);
+            _run(chunks, pool, [&] (size_t c, workspace & ws)
+            {
+                double * acc = partial.data() + c * m;
+                std::vector < double > & density = ws.segment;
+                for (size_t f = frames * c / chunks; f < frames * (c + 1) / chunks; ++f)
+                {
+                    _frame(input, f, ws);
+                    _density(ws, fs, density.data());
+                    for (size_t k = 0; k < m; ++k) acc[k] += density[k];
+                }
+            });
+            for (size_t k = 0; k < m; ++k)
+            {
+                double s = 0;
+                for (size_t c = 0; c < chunks; ++c) s += partial[c * m + k];
+                psd.samples[k] = s / frames;
+            }
+        }
+    };
+}
@@ -0,0 +1,713 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+#include <util/common/math/simd.h>
+#include <util/common/math/generators.h>
+#include <util/common/thread_pool.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                 Jacobi pair kernels               */
+    /*****************************************************/
+
+    /* `n` is a multiple of 4 in all the kernels; the pair
+       `x`, `y` are two contiguous columns */
+
+    /* s = { x . x, y . y, x . y } */
+    inline void _svd_sums_scalar(const double * x, const double * y, size_t n, double s[3])
+    {
+        double a0 = 0, a1 = 0, b0 = 0, b1 = 0, h0 = 0, h1 = 0;
+        for (size_t i = 0; i < n; i += 2)
+        {
+            a0 += x[i] * x[i];         a1 += x[i + 1] * x[i + 1];
+            b0 += y[i] * y[i];         b1 += y[i + 1] * y[i + 1];
+            h0 += x[i] * y[i];         h1 += x[i + 1] * y[i + 1];
+        }
+        s[0] = a0 + a1; s[1] = b0 + b1; s[2] = h0 + h1;
+    }
+
+    /* x' = x cos - y sin, y' = x sin + y cos */
+    inline void _svd_rotate_scalar(double * x, double * y, size_t n, double c, double s)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            double t = x[i] * c - y[i] * s;
+            y[i] = x[i] * s + y[i] * c;
+            x[i] = t;
+        }
+    }
+
+#ifdef UTIL_SIMD_X86
+
+    UTIL_SIMD_TARGET("sse2")
+    inline double _svd_hsum_sse2(__m128d v)
+    {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+
+    UTIL_SIMD_TARGET("sse2")
+    inline void _svd_sums_sse2(const double * x, const double * y, size_t n, double s[3])
+    {
+        __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd(), h = _mm_setzero_pd();
+        for (size_t i = 0; i < n; i += 2)
+        {
+            __m128d xv = _mm_loadu_pd(x + i), yv = _mm_loadu_pd(y + i);
+            a = _mm_add_pd(a, _mm_mul_pd(xv, xv));
+            b = _mm_add_pd(b, _mm_mul_pd(yv, yv));
+            h = _mm_add_pd(h, _mm_mul_pd(xv, yv));
+        }
+        s[0] = _svd_hsum_sse2(a); s[1] = _svd_hsum_sse2(b); s[2] = _svd_hsum_sse2(h);
+    }
+
+    UTIL_SIMD_TARGET("sse2")
+    inline void _svd_rotate_sse2(double * x, double * y, size_t n, double c, double s)
+    {
+        __m128d cv = _mm_set1_pd(c), sv = _mm_set1_pd(s);
+        for (size_t i = 0; i < n; i += 2)
+        {
+            __m128d xv = _mm_loadu_pd(x + i), yv = _mm_loadu_pd(y + i);
+            _mm_storeu_pd(x + i, _mm_sub_pd(_mm_mul_pd(xv, cv), _mm_mul_pd(yv, sv)));
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_mul_pd(xv, sv), _mm_mul_pd(yv, cv)));
+        }
+    }
+
+    UTIL_SIMD_TARGET("avx")
+    inline double _svd_hsum_avx(__m256d v)
+    {
+        __m128d h = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+    }
+
+    UTIL_SIMD_TARGET("avx")
+    inline void _svd_sums_avx(const double * x, const double * y, size_t n, double s[3])
+    {
+        __m256d a0 = _mm256_setzero_pd(), b0 = _mm256_setzero_pd(), h0 = _mm256_setzero_pd();
+        __m256d a1 = _mm256_setzero_pd(), b1 = _mm256_setzero_pd(), h1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256d x0 = _mm256_loadu_pd(x + i), y0 = _mm256_loadu_pd(y + i);
+            __m256d x1 = _mm256_loadu_pd(x + i + 4), y1 = _mm256_loadu_pd(y + i + 4);
+            a0 = _mm256_add_pd(a0, _mm256_mul_pd(x0, x0));
+            b0 = _mm256_add_pd(b0, _mm256_mul_pd(y0, y0));
+            h0 = _mm256_add_pd(h0, _mm256_mul_pd(x0, y0));
+            a1 = _mm256_add_pd(a1, _mm256_mul_pd(x1, x1));
+            b1 = _mm256_add_pd(b1, _mm256_mul_pd(y1, y1));
+            h1 = _mm256_add_pd(h1, _mm256_mul_pd(x1, y1));
+        }
+        if (i < n)
+        {
+            __m256d x0 = _mm256_loadu_pd(x + i), y0 = _mm256_loadu_pd(y + i);
+            a0 = _mm256_add_pd(a0, _mm256_mul_pd(x0, x0));
+            b0 = _mm256_add_pd(b0, _mm256_mul_pd(y0, y0));
+            h0 = _mm256_add_pd(h0, _mm256_mul_pd(x0, y0));
+        }
+        s[0] = _svd_hsum_avx(_mm256_add_pd(a0, a1));
+        s[1] = _svd_hsum_avx(_mm256_add_pd(b0, b1));
+        s[2] = _svd_hsum_avx(_mm256_add_pd(h0, h1));
+        _mm256_zeroupper();
+    }
+
+    UTIL_SIMD_TARGET("avx")
+    inline void _svd_rotate_avx(double * x, double * y, size_t n, double c, double s)
+    {
+        __m256d cv = _mm256_set1_pd(c), sv = _mm256_set1_pd(s);
+        for (size_t i = 0; i < n; i += 4)
+        {
+            __m256d xv = _mm256_loadu_pd(x + i), yv = _mm256_loadu_pd(y + i);
+            _mm256_storeu_pd(x + i, _mm256_sub_pd(_mm256_mul_pd(xv, cv), _mm256_mul_pd(yv, sv)));
+            _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_mul_pd(xv, sv), _mm256_mul_pd(yv, cv)));
+        }
+        _mm256_zeroupper();
+    }
+
+#endif
+
+    /**
+     * Instrumentation of the last `svd_workspace` run.
+     */
+    using svd_stats = struct
+    {
+        /* sweeps, including the final one without rotations */
+        int sweeps;
+        /* rotations performed over all the sweeps */
+        size_t rotations;
+        /* wall time of the iterations and the sort (s) */
+        double seconds;
+    };
+
+    /*****************************************************/
+    /*                   svd_workspace                   */
+    /*****************************************************/
+
+    /**
+     * One-sided (Hestenes) Jacobi SVD, `a = u diag(sigma) v^T`,
+     * with the same rotations and convergence criterion as
+     * `svd_hestenes`, but on column-major storage: each pair
+     * rotation streams two contiguous columns of `u` (and `v`)
+     * instead of striding through the rows of the matrix.
+     *
+     * The buffers persist between calls, so decomposing
+     * many matrices of the same size allocates nothing.
+     * Columns are padded with zeros to a multiple of 4.
+     *
+     * The results are sorted by descending singular value;
+     * `copy_to` writes them in the `svd_hestenes` layout.
+     *
+     * With a `thread_pool` the sweeps visit the column pairs
+     * in the round-robin (tournament) order: each of the
+     * `n - 1` rounds (`n` if odd) pairs every column exactly
+     * once, so its rotations touch disjoint columns and run
+     * concurrently. The convergence criterion stays the same
+     * (a sweep without rotations); the result differs from
+     * the serial one only by the rotation order and does not
+     * depend on the number of workers.
+     */
+    class svd_workspace
+    {
+
+    private:
+
+        int m, n;
+        size_t ldu, ldv;
+        bool with_v;
+        simd::level isa;
+
+        /* u[j * ldu + i], v[j * ldv + i] */
+        std::vector < double > _u, _v, _sigma, _buffer;
+        std::vector < int > _order;
+
+        /* round-robin schedule: columns of the current round
+           (`n` rounded up to even, the last one may be a dummy)
+           and the rotation flags of its pairs */
+        std::vector < int > _players;
+        std::vector < char > _rotated;
+
+        svd_stats _stats;
+
+    public:
+
+        /* rotation threshold and null column norm of `svd_hestenes` */
+        static double threshold() { return 1e-4; }
+        static double null_norm() { return 1e-16; }
+
+        svd_workspace(simd::level isa = simd::avx2)
+            : m(0), n(0), ldu(0), ldv(0)
+            , with_v(true)
+            , isa(simd::select(isa))
+        {
+            _stats.sweeps = 0;
+            _stats.rotations = 0;
+            _stats.seconds = 0;
+        }
+
+        /**
+         * Decomposes the row-major `m x n` matrix `a`.
+         *
+         * Parameters:
+         *      with_v     - skip the accumulation of `v`
+         *                   if false
+         *      max_sweeps - the sweep limit
+         *
+         * Returns:
+         *      the number of sweeps (as `svd_hestenes`) or
+         *      -1 if the limit is exceeded (as `svd_toepliz`)
+         */
+        int decompose(int m, int n, const double * a,
+                      bool with_v = true, int max_sweeps = 100000)
+        {
+            _prepare(m, n, with_v);
+            _load(a);
+            return _solve(max_sweeps, nullptr);
+        }
+
+        int decompose(int m, int n, const double * a, util::thread_pool & pool,
+                      bool with_v = true, int max_sweeps = 100000)
+        {
+            _prepare(m, n, with_v);
+            _load(a);
+            return _solve(max_sweeps, &pool);
+        }
+
+        /**
+         * Decomposes the `m x n` matrix determined by
+         * a single line: `a[i][j] = a[|i - j|]`
+         * (the `svd_toepliz` input).
+         */
+        int decompose_toeplitz(int m, int n, const double * a,
+                               bool with_v = true, int max_sweeps = 100000)
+        {
+            _prepare(m, n, with_v);
+            _load_toeplitz(a);
+            return _solve(max_sweeps, nullptr);
+        }
+
+        int decompose_toeplitz(int m, int n, const double * a, util::thread_pool & pool,
+                               bool with_v = true, int max_sweeps = 100000)
+        {
+            _prepare(m, n, with_v);
+            _load_toeplitz(a);
+            return _solve(max_sweeps, &pool);
+        }
+
+        int rows() const { return m; }
+        int cols() const { return n; }
+        bool has_v() const { return with_v; }
+        const svd_stats & stats() const { return _stats; }
+
+        const double * sigma() const { return _sigma.data(); }
+        const double * u_column(int j) const { return _u.data() + j * ldu; }
+        const double * v_column(int j) const { return _v.data() + j * ldv; }
+        double u(int i, int j) const { return _u[j * ldu + i]; }
+        double v(int i, int j) const { return _v[j * ldv + i]; }
+
+        /**
+         * Writes the results in the `svd_hestenes` layout:
+         * row-major `m x n` `u` and `n x n` `v`;
+         * any of the pointers may be null.
+         */
+        void copy_to(double * u, double * v, double * sigma) const
+        {
+            if (u != nullptr)
+                for (int i = 0; i < m; ++i)
+                for (int j = 0; j < n; ++j)
+                    u[i * n + j] = _u[j * ldu + i];
+            if ((v != nullptr) && with_v)
+                for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    v[i * n + j] = _v[j * ldv + i];
+            if (sigma != nullptr)
+                for (int j = 0; j < n; ++j) sigma[j] = _sigma[j];
+        }
+
+    private:
+
+        void _prepare(int m, int n, bool with_v)
+        {
+            assert((m > 0) && (n > 0));
+            this->m = m; this->n = n; this->with_v = with_v;
+            ldu = ((size_t) m + 3) & ~(size_t) 3;
+            ldv = ((size_t) n + 3) & ~(size_t) 3;
+            _u.assign(ldu * n, 0.);
+            if (with_v)
+            {
+                _v.assign(ldv * n, 0.);
+                for (int j = 0; j < n; ++j) _v[j * ldv + j] = 1;
+            }
+            _sigma.resize(n);
+        }
+
+        void _load(const double * a)
+        {
+            for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+            {
+                _u[j * ldu + i] = a[i * n + j];
+            }
+        }
+
+        void _load_toeplitz(const double * a)
+        {
+            for (int j = 0; j < n; ++j)
+            for (int i = 0; i < m; ++i)
+            {
+                _u[j * ldu + i] = a[(i > j) ? (i - j) : (j - i)];
+            }
+        }
+
+        void _sums(const double * x, const double * y, size_t count, double s[3]) const
+        {
+        #ifdef UTIL_SIMD_X86
+            if (isa >= simd::avx) { _svd_sums_avx(x, y, count, s); return; }
+            if (isa >= simd::sse2) { _svd_sums_sse2(x, y, count, s); return; }
+        #endif
+            _svd_sums_scalar(x, y, count, s);
+        }
+
+        void _rotate(double * x, double * y, size_t count, double c, double s) const
+        {
+        #ifdef UTIL_SIMD_X86
+            if (isa >= simd::avx) { _svd_rotate_avx(x, y, count, c, s); return; }
+            if (isa >= simd::sse2) { _svd_rotate_sse2(x, y, count, c, s); return; }
+        #endif
+            _svd_rotate_scalar(x, y, count, c, s);
+        }
+
+        /* orthogonalizes columns `l` and `k`;
+           false if they are already orthogonal */
+        bool _rotate_pair(int l, int k)
+        {
+            double * x = _u.data() + l * ldu, * y = _u.data() + k * ldu;
+            double s[3];
+            _sums(x, y, ldu, s);
+            double alfa = s[0], betta = s[1], hamma = s[2];
+
+            double norm = std::sqrt(alfa * betta);
+            if (norm < null_norm()) return false;
+            if (std::abs(hamma) / norm < threshold()) return false;
+
+            double eta = (betta - alfa) / (2 * hamma);
+            double t = ((eta < 0) ? -1. : 1.) / (std::abs(eta) + std::sqrt(1 + eta * eta));
+            double cos0 = 1 / std::sqrt(1 + t * t);
+            double sin0 = t * cos0;
+
+            _rotate(x, y, ldu, cos0, sin0);
+            if (with_v) _rotate(_v.data() + l * ldv, _v.data() + k * ldv, ldv, cos0, sin0);
+            return true;
+        }
+
+        int _solve(int max_sweeps, util::thread_pool * pool)
+        {
+            using clock = std::chrono::high_resolution_clock;
+            auto start = clock::now();
+            _stats.sweeps = 0;
+            _stats.rotations = 0;
+
+            int iter = 0;
+            for (;;)
+            {
+                if (++iter > max_sweeps) { iter = -1; break; }
+                _stats.sweeps = iter;
+                size_t rotations = (pool == nullptr) ? _sweep() : _sweep(*pool);
+                _stats.rotations += rotations;
+                if (rotations == 0) break;
+            }
+            if (iter > 0) _finish();
+
+            _stats.seconds = std::chrono::duration < double > (clock::now() - start).count();
+            return iter;
+        }
+
+        /* the `svd_hestenes` cyclic order */
+        size_t _sweep()
+        {
+            size_t rotations = 0;
+            for (int l = 0; l < n - 1; ++l)
+            for (int k = l + 1; k < n; ++k)
+            {
+                if (_rotate_pair(l, k)) ++rotations;
+            }
+            return rotations;
+        }
+
+        /* the round-robin order, a round at a time */
+        size_t _sweep(util::thread_pool & pool)
+        {
+            int players = n + (n & 1), pairs = players / 2;
+            _players.resize(players);
+            for (int j = 0; j < players; ++j) _players[j] = j;
+            _rotated.resize(pairs);
+
+            size_t rotations = 0;
+            for (int round = 0; round < players - 1; ++round)
+            {
+                pool.run(pairs, [&] (size_t p, size_t)
+                {
+                    int l = _players[p], k = _players[players - 1 - p];
+                    if (l > k) std::swap(l, k);
+                    _rotated[p] = (k < n) && _rotate_pair(l, k);
+                });
+                for (int p = 0; p < pairs; ++p) rotations += _rotated[p];
+
+                /* the first player stays, the others circulate */
+                std::rotate(_players.begin() + 1, _players.end() - 1, _players.end());
+            }
+            return rotations;
+        }
+
+        /* column norms become `sigma`, columns are normalized
+           and reordered by descending `sigma` */
+        void _finish()
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                double * x = _u.data() + j * ldu;
+                double s = 0;
+                for (int i = 0; i < m; ++i) s += x[i] * x[i];
+                s = std::sqrt(s);
+                _sigma[j] = s;
+                if (s < null_norm()) continue;
+                for (int i = 0; i < m; ++i) x[i] /= s;
+            }
+
+            _order.resize(n);
+            for (int j = 0; j < n; ++j) _order[j] = j;
+            const std::vector < double > & sigma = _sigma;
+            std::stable_sort(_order.begin(), _order.end(),
+                             [&sigma] (int a, int b) { return sigma[a] > sigma[b]; });
+
+            _permute(_u, ldu);
+            if (with_v) _permute(_v, ldv);
+            _buffer.resize(n);
+            for (int j = 0; j < n; ++j) _buffer[j] = _sigma[_order[j]];
+            _sigma.swap(_buffer);
+        }
+
+        void _permute(std::vector < double > & columns, size_t ld)
+        {
+            _buffer.resize(columns.size());
+            for (int j = 0; j < n; ++j)
+            {
+                std::copy(columns.begin() + _order[j] * ld,
+                          columns.begin() + (_order[j] + 1) * ld,
+                          _buffer.begin() + j * ld);
+            }
+            columns.swap(_buffer);
+        }
+    };
+
+    /**
+     * Drop-in replacement for `svd_hestenes` (same
+     * arguments and layout) on a temporary workspace.
+     */
+    inline int svd_jacobi(int m, int n, const double * a,
+                          double * u, double * v, double * sigma)
+    {
+        svd_workspace w;
+        int iter = w.decompose(m, n, a);
+        w.copy_to(u, v, sigma);
+        return iter;
+    }
+
+    /*****************************************************/
+    /*                   truncated_svd                   */
+    /*****************************************************/
+
+    /**
+     * The leading `k` singular triplets of the row-major
+     * `m x n` matrix `a` by the randomized range finder:
+     *
+     *      Y = (A A^T)^q A W,   W ~ N(0, 1) of `n x l`,
+     *      Q = orth(Y),   A^T Q = P R,   R^T = U_r S V_r^T,
+     *      A ~ (Q U_r) S (P V_r)^T,
+     *
+     * `l = k + oversampling` sketch columns and `q` power
+     * iterations, each product re-orthonormalized. The cost
+     * is O(m n l (2 q + 2)) against O(m n^2) per sweep of
+     * the full decomposition; only the `l x l` core `R^T`
+     * is decomposed by `svd_workspace`.
+     *
+     * Without `v` the core does not accumulate `V_r`
+     * and the `P V_r` product is skipped.
+     *
+     * The sketch is drawn from `xoshiro256(seed)`, so equal
+     * inputs give equal results. The buffers persist
+     * between calls.
+     */
+    class truncated_svd
+    {
+
+    private:
+
+        int m, n, k, l;
+        bool with_v;
+        svd_workspace core;
+
+        /* row-major: q (m x l), p (n x l), r (l x l),
+           u (m x k), v (n x k) */
+        std::vector < double > _q, _p, _r, _core, _d;
+        std::vector < double > _u, _v, _sigma;
+
+    public:
+
+        truncated_svd(simd::level isa = simd::avx2)
+            : m(0), n(0), k(0), l(0)
+            , with_v(true)
+            , core(isa)
+        {
+        }
+
+        /**
+         * Parameters:
+         *      k                - the number of triplets,
+         *                         limited to `min(m, n)`
+         *      with_v           - skip the right singular
+         *                         vectors if false
+         *      power_iterations - `q`, 1-3 for the slowly
+         *                         decaying spectra
+         *      oversampling     - extra sketch columns
+         *
+         * Returns:
+         *      the number of the core Jacobi sweeps or -1
+         *      (see `svd_workspace::decompose`)
+         */
+        int decompose(int m, int n, const double * a, int k,
+                      bool with_v = true,
+                      int power_iterations = 2,
+                      int oversampling = 10,
+                      uint64_t seed = 0)
+        {
+            assert((m > 0) && (n > 0) && (k > 0));
+            this->m = m; this->n = n; this->with_v = with_v;
+            int r = (std::min)(m, n);
+            this->k = k = (std::min)(k, r);
+            l = (std::min)(k + (std::max)(oversampling, 0), r);
+
+            _q.resize((size_t) m * l);
+            _p.resize((size_t) n * l);
+            _r.resize((size_t) l * l);
+            _core.resize((size_t) l * l);
+            _d.resize(l);
+
+            _gaussian(_p.data(), (size_t) n * l, seed);
+            _multiply(a, _p.data(), _q.data());
+            _orthonormalize(_q.data(), m, nullptr);
+            for (int it = 0; it < power_iterations; ++it)
+            {
+                _multiply_transposed(a, _q.data(), _p.data());
+                _orthonormalize(_p.data(), n, nullptr);
+                _multiply(a, _p.data(), _q.data());
+                _orthonormalize(_q.data(), m, nullptr);
+            }
+            _multiply_transposed(a, _q.data(), _p.data());
+            _orthonormalize(_p.data(), n, _r.data());
+
+            for (int i = 0; i < l; ++i)
+            for (int j = 0; j < l; ++j)
+            {
+                _core[i * l + j] = _r[j * l + i];
+            }
+            int iter = core.decompose(l, l, _core.data(), with_v);
+            if (iter < 0) return iter;
+
+            _sigma.assign(core.sigma(), core.sigma() + k);
+            _u.resize((size_t) m * k);
+            _lift(_q.data(), m, true, _u.data());
+            if (with_v)
+            {
+                _v.resize((size_t) n * k);
+                _lift(_p.data(), n, false, _v.data());
+            }
+            return iter;
+        }
+
+        int rows() const { return m; }
+        int cols() const { return n; }
+        int rank() const { return k; }
+        bool has_v() const { return with_v; }
+
+        const double * sigma() const { return _sigma.data(); }
+        double u(int i, int j) const { return _u[i * k + j]; }
+        double v(int i, int j) const { return _v[i * k + j]; }
+
+        /**
+         * Writes row-major `m x k` `u` and `n x k` `v`
+         * (the `svd_hestenes` layout truncated to `k`
+         * columns); any of the pointers may be null.
+         */
+        void copy_to(double * u, double * v, double * sigma) const
+        {
+            if (u != nullptr) std::copy(_u.begin(), _u.end(), u);
+            if ((v != nullptr) && with_v) std::copy(_v.begin(), _v.end(), v);
+            if (sigma != nullptr) std::copy(_sigma.begin(), _sigma.end(), sigma);
+        }
+
+    private:
+
+        /* standard normal numbers by the Box-Muller transform */
+        static void _gaussian(double * out, size_t count, uint64_t seed)
+        {
+            xoshiro256 rng(seed);
+            const double pi2 = 2 * M_PI;
+            for (size_t i = 0; i < count; i += 2)
+            {
+                double r = std::sqrt(-2 * std::log(1 - rng.uniform()));
+                double f = pi2 * rng.uniform();
+                out[i] = r * std::cos(f);
+                if (i + 1 < count) out[i + 1] = r * std::sin(f);
+            }
+        }
+
+        /* y (m x l) = a x (n x l), `a` streamed by rows */
+        void _multiply(const double * a, const double * x, double * y) const
+        {
+            for (int i = 0; i < m; ++i)
+            {
+                double * yi = y + (size_t) i * l;
+                std::fill(yi, yi + l, 0.);
+                const double * ai = a + (size_t) i * n;
+                for (int j = 0; j < n; ++j)
+                {
+                    const double * xj = x + (size_t) j * l;
+                    double aij = ai[j];
+                    for (int c = 0; c < l; ++c) yi[c] += aij * xj[c];
+                }
+            }
+        }
+
+        /* x (n x l) = a^T y (m x l), `a` streamed by rows */
+        void _multiply_transposed(const double * a, const double * y, double * x) const
+        {
+            std::fill(x, x + (size_t) n * l, 0.);
+            for (int i = 0; i < m; ++i)
+            {
+                const double * yi = y + (size_t) i * l;
+                const double * ai = a + (size_t) i * n;
+                for (int j = 0; j < n; ++j)
+                {
+                    double * xj = x + (size_t) j * l;
+                    double aij = ai[j];
+                    for (int c = 0; c < l; ++c) xj[c] += aij * yi[c];
+                }
+            }
+        }
+
+        /* classical Gram-Schmidt with reorthogonalization on
+           the `l` columns of the row-major `x`; `r` receives
+           the upper triangular factor if not null */
+        void _orthonormalize(double * x, int rows, double * r)
+        {
+            if (r != nullptr) std::fill(r, r + (size_t) l * l, 0.);
+            for (int c = 0; c < l; ++c)
+            {
+                for (int pass = 0; pass < 2; ++pass)
+                {
+                    if (c == 0) break;
+                    std::fill(_d.begin(), _d.begin() + c, 0.);
+                    for (int i = 0; i < rows; ++i)
+                    {
+                        const double * xi = x + (size_t) i * l;
+                        for (int j = 0; j < c; ++j) _d[j] += xi[j] * xi[c];
+                    }
+                    for (int i = 0; i < rows; ++i)
+                    {
+                        double * xi = x + (size_t) i * l, s = 0;
+                        for (int j = 0; j < c; ++j) s += _d[j] * xi[j];
+                        xi[c] -= s;
+                    }
+                    if (r != nullptr) for (int j = 0; j < c; ++j) r[j * l + c] += _d[j];
+                }
+                double s = 0;
+                for (int i = 0; i < rows; ++i) s += x[(size_t) i * l + c] * x[(size_t) i * l + c];
+                s = std::sqrt(s);
+                if (r != nullptr) r[c * l + c] = s;
+                /* the range is exhausted (rank < l) */
+                double f = (s > 0) ? 1 / s : 0;
+                for (int i = 0; i < rows; ++i) x[(size_t) i * l + c] *= f;
+            }
+        }
+
+        /* out (rows x k) = basis (rows x l) times the first
+           `k` core `u` (or `v`) columns */
+        void _lift(const double * basis, int rows, bool left, double * out) const
+        {
+            for (int i = 0; i < rows; ++i)
+            {
+                const double * bi = basis + (size_t) i * l;
+                for (int c = 0; c < k; ++c)
+                {
+                    double s = 0;
+                    for (int j = 0; j < l; ++j) s += bi[j] * (left ? core.u(j, c) : core.v(j, c));
+                    out[(size_t) i * k + c] = s;
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,520 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <util/common/math/convolution.h>
+#include <util/common/math/generators.h>
+
+namespace math
+{
+
+    /*****************************************************/
+    /*                 Levinson-Durbin                   */
+    /*****************************************************/
+
+    /**
+     * Fits the autoregressive model of the given `order`
+     * to the autocorrelation sequence `r[0 .. order]` by the
+     * Levinson-Durbin recursion in O(order^2), i.e. solves
+     * the Yule-Walker system whose matrix is defined by
+     * a single row, as in `svd_toepliz`: `R[i][j] = r[|i - j|]`.
+     *
+     * Parameters:
+     *      ar         - `order` predictor coefficients:
+     *                   x[n] ~ sum_k ar[k] x[n - 1 - k]
+     *      reflection - `order` reflection (PARCOR)
+     *                   coefficients, may be null
+     *      error      - the final prediction error power,
+     *                   may be null
+     *
+     * Returns:
+     *      false if the sequence is not positive definite
+     *      (|reflection| >= 1); the outputs then hold the
+     *      model of the last stable order
+     */
+    inline bool levinson_durbin(const double * r, int order,
+                                double * ar,
+                                double * reflection = nullptr,
+                                double * error = nullptr)
+    {
+        assert(order >= 0);
+        std::vector < double > prev(order);
+        double e = r[0];
+        for (int i = 0; i < order; ++i) ar[i] = 0;
+        if (reflection != nullptr) for (int i = 0; i < order; ++i) reflection[i] = 0;
+        if (error != nullptr) *error = e;
+        if (!(e > 0)) return (order == 0) && (e == 0);
+
+        for (int i = 0; i < order; ++i)
+        {
+            double acc = r[i + 1];
+            for (int j = 0; j < i; ++j) acc -= ar[j] * r[i - j];
+            double k = acc / e;
+            if (!(std::abs(k) < 1)) return false;
+
+            for (int j = 0; j < i; ++j) prev[j] = ar[j];
+            for (int j = 0; j < i; ++j) ar[j] = prev[j] - k * prev[i - 1 - j];
+            ar[i] = k;
+            e *= (1 - k * k);
+
+            if (reflection != nullptr) reflection[i] = k;
+            if (error != nullptr) *error = e;
+        }
+        return true;
+    }
+
+    /**
+     * Solves the symmetric Toeplitz system `T x = b`,
+     * `T[i][j] = t[|i - j|]`, by the Levinson recursion
+     * in O(n^2) time and O(n) memory.
+     *
+     * Returns:
+     *      false if a leading principal minor of `T`
+     *      is singular
+     */
+    inline bool toeplitz_solve(const double * t, const double * b, double * x, int n)
+    {
+        assert(n > 0);
+        if (t[0] == 0) return false;
+
+        /* normalized to t[0] = 1; `y` solves the Yule-Walker
+           system of the current size, `x` the actual one */
+        double t0 = t[0];
+        std::vector < double > y(n), z(n);
+        x[0] = b[0] / t0;
+        if (n == 1) return true;
+        y[0] = - t[1] / t0;
+        double beta = 1, alpha = y[0];
+
+        for (int k = 1; k < n; ++k)
+        {
+            beta *= (1 - alpha * alpha);
+            if (beta == 0) return false;
+
+            double mu = b[k] / t0;
+            for (int j = 0; j < k; ++j) mu -= t[j + 1] / t0 * x[k - 1 - j];
+            mu /= beta;
+            for (int j = 0; j < k; ++j) x[j] += mu * y[k - 1 - j];
+            x[k] = mu;
+
+            if (k == n - 1) break;
+
+            alpha = - t[k + 1] / t0;
+            for (int j = 0; j < k; ++j) alpha -= t[j + 1] / t0 * y[k - 1 - j];
+            alpha /= beta;
+            for (int j = 0; j < k; ++j) z[j] = y[j] + alpha * y[k - 1 - j];
+            for (int j = 0; j < k; ++j) y[j] = z[j];
+            y[k] = alpha;
+        }
+        return true;
+    }
+
+    /*****************************************************/
+    /*                 toeplitz_operator                 */
+    /*****************************************************/
+
+    /**
+     * Product of the symmetric `n x n` Toeplitz matrix
+     * `T[i][j] = t[|i - j|]` and a vector in O(n log n):
+     * `T` is embedded into the circulant of `N >= 2 n - 1`
+     * samples, whose product is a cyclic convolution.
+     */
+    class toeplitz_operator
+    {
+
+    private:
+
+        size_t n, nfft;
+        rfft_plan forward, inverse;
+        std::vector < complex < > > kernel, spectrum, scratch;
+        std::vector < double > block;
+
+    public:
+
+        toeplitz_operator(const double * t, size_t n, simd::level isa = simd::avx2)
+            : n(n)
+            , nfft(fft_fast_size(2 * n))
+            , forward(nfft, -1, isa)
+            , inverse(nfft, 1, isa)
+            , kernel(nfft / 2 + 1)
+            , spectrum(nfft / 2 + 1)
+            , scratch((std::max)(forward.scratch_size(), inverse.scratch_size()))
+            , block(nfft, 0.)
+        {
+            assert(n > 0);
+            /* the circulant column: t[0 .. n), zeros, t(n .. 0] */
+            for (size_t k = 0; k < n; ++k) block[k] = t[k];
+            for (size_t k = 1; k < n; ++k) block[nfft - k] = t[k];
+            forward.execute(block.data(), kernel.data(), scratch.data());
+        }
+
+        size_t size() const { return n; }
+
+        /* y = T x; `x` and `y` may coincide */
+        void apply(const double * x, double * y)
+        {
+            std::copy(x, x + n, block.begin());
+            std::fill(block.begin() + n, block.end(), 0.);
+            forward.execute(block.data(), spectrum.data(), scratch.data());
+            _multiply_spectra(spectrum.data(), kernel.data(), spectrum.size());
+            inverse.execute(spectrum.data(), block.data(), scratch.data());
+            std::copy(block.begin(), block.begin() + n, y);
+        }
+
+    private:
+
+        toeplitz_operator(const toeplitz_operator &);
+        toeplitz_operator & operator = (const toeplitz_operator &);
+    };
+
+    /*****************************************************/
+    /*               tridiagonal eigenproblem            */
+    /*****************************************************/
+
+    /**
+     * Eigenvalues and eigenvectors of the symmetric
+     * tridiagonal matrix by the implicit QL method.
+     *
+     * Parameters:
+     *      d - `n` diagonal elements, overwritten
+     *          with the eigenvalues (unordered)
+     *      e - `n - 1` off-diagonal elements
+     *          (`e[i]` couples `i` and `i + 1`), destroyed;
+     *          must hold `n` elements
+     *      z - row-major `rows x n`, overwritten with the
+     *          last `rows` rows of the eigenvector matrix
+     *          (the eigenvectors are in the columns); `rows`
+     *          less than `n` spares O(n^3) work when only
+     *          the trailing components are needed
+     *
+     * Returns:
+     *      false if an eigenvalue fails to converge
+     *      in 30 iterations
+     */
+    inline bool tridiagonal_eigen(double * d, double * e, double * z, int n, int rows = -1)
+    {
+        const double eps = std::numeric_limits < double > ::epsilon();
+        if (rows < 0) rows = n;
+        for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < n; ++j)
+        {
+            z[i * n + j] = (n - rows + i == j) ? 1. : 0.;
+        }
+        e[n - 1] = 0;
+
+        for (int l = 0; l < n; ++l)
+        {
+            int iter = 0, m;
+            do
+            {
+                for (m = l; m < n - 1; ++m)
+                {
+                    double dd = std::abs(d[m]) + std::abs(d[m + 1]);
+                    if (std::abs(e[m]) <= eps * dd) break;
+                }
+                if (m == l) break;
+                if (iter++ == 30) return false;
+
+                double g = (d[l + 1] - d[l]) / (2 * e[l]);
+                double r = std::sqrt(g * g + 1);
+                g = d[m] - d[l] + e[l] / (g + ((g < 0) ? -r : r));
+                double s = 1, c = 1, p = 0;
+                int i;
+                for (i = m - 1; i >= l; --i)
+                {
+                    double f = s * e[i], b = c * e[i];
+                    e[i + 1] = r = std::sqrt(f * f + g * g);
+                    if (r == 0)
+                    {
+                        d[i + 1] -= p;
+                        e[m] = 0;
+                        break;
+                    }
+                    s = f / r;
+                    c = g / r;
+                    g = d[i + 1] - p;
+                    r = (d[i] - g) * s + 2 * c * b;
+                    p = s * r;
+                    d[i + 1] = g + p;
+                    g = c * r - b;
+                    for (int k = 0; k < rows; ++k)
+                    {
+                        f = z[k * n + i + 1];
+                        z[k * n + i + 1] = s * z[k * n + i] + c * f;
+                        z[k * n + i] = c * z[k * n + i] - s * f;
+                    }
+                }
+                if ((r == 0) && (i >= l)) continue;
+                d[l] -= p;
+                e[l] = g;
+                e[m] = 0;
+            } while (m != l);
+        }
+        return true;
+    }
+
+    /*****************************************************/
+    /*                 toeplitz_lanczos                  */
+    /*****************************************************/
+
+    /**
+     * The leading `k` singular triplets of the symmetric
+     * `n x n` Toeplitz matrix `T[i][j] = t[|i - j|]` (the
+     * `svd_toepliz` input) by the Lanczos method with full
+     * reorthogonalization.
+     *
+     * `T` enters only through `toeplitz_operator`, so a step
+     * costs O(n log n) for the product and O(n j) for the
+     * reorthogonalization against the `j` basis vectors; the
+     * memory is O(n max_dim). `svd_toepliz` needs O(n^2)
+     * memory and O(n^3) per sweep.
+     *
+     * For the symmetric `T` the singular values are the
+     * eigenvalue magnitudes: `sigma = |lambda|`,
+     * `v = y`, `u = sign(lambda) y` for the Ritz vector `y`.
+     *
+     * The number of steps grows as the gap between the wanted
+     * and the remaining eigenvalues shrinks: a few tones in
+     * noise converge in tens of steps at any `n`, a smooth
+     * symbol with clustered leading eigenvalues may need
+     * a larger `max_dim`.
+     */
+    class toeplitz_lanczos
+    {
+
+    private:
+
+        int n, k, dim;
+        simd::level isa;
+
+        /* basis[j * n + i], j < dim */
+        std::vector < double > basis, alpha, beta;
+        std::vector < double > w, d, e, z;
+        std::vector < double > _y, _sigma, _sign;
+        std::vector < int > _order;
+
+    public:
+
+        toeplitz_lanczos(simd::level isa = simd::avx2)
+            : n(0), k(0), dim(0)
+            , isa(isa)
+        {
+        }
+
+        /**
+         * Parameters:
+         *      k         - the number of triplets
+         *      tolerance - the Ritz pair is converged if
+         *                  `|T y - lambda y| <= tolerance sigma[0]`
+         *      max_dim   - the Krylov subspace dimension limit,
+         *                  `min(n, max(4 k, k + 60))` if 0
+         *
+         * Returns:
+         *      the number of Lanczos steps, -1 if `max_dim`
+         *      is reached before convergence (the results then
+         *      hold the current approximations), -2 if the
+         *      tridiagonal eigenproblem fails (e.g. on a
+         *      non-finite `t`; the results are then zero)
+         */
+        int decompose(const double * t, int n, int k,
+                      double tolerance = 1e-10,
+                      int max_dim = 0,
+                      uint64_t seed = 0)
+        {
+            assert((n > 0) && (k > 0));
+            this->n = n;
+            this->k = k = (std::min)(k, n);
+            if (max_dim <= 0) max_dim = (std::max)(4 * k, k + 60);
+            max_dim = (std::min)((std::max)(max_dim, k), n);
+
+            _sigma.assign(k, 0.);
+            _sign.assign(k, 1.);
+
+            toeplitz_operator op(t, n, isa);
+            xoshiro256 rng(seed);
+            basis.resize((size_t) n * max_dim);
+            alpha.resize(max_dim);
+            beta.resize(max_dim);
+            w.resize(n);
+
+            _start(0, rng);
+            bool converged = false, failed = false;
+            for (dim = 1; ; ++dim)
+            {
+                int j = dim - 1;
+                double * q = basis.data() + (size_t) j * n;
+                op.apply(q, w.data());
+                alpha[j] = _dot(q, w.data());
+                beta[j] = _orthogonalize(w.data(), dim);
+
+                bool exhausted = (dim == max_dim);
+                bool breakdown = !(beta[j] > 1e-14 * _norm_estimate(dim));
+                if ((dim >= k) && (exhausted || breakdown || (dim % 10 == 0)))
+                {
+                    if (!_ritz(1)) { failed = true; break; }
+                    converged = _converged(tolerance);
+                    if (converged || exhausted) break;
+                }
+                else if (exhausted) break;
+
+                double * next = basis.data() + (size_t) dim * n;
+                if (breakdown)
+                {
+                    /* an invariant subspace: continue in its complement */
+                    beta[j] = 0;
+                    _start(dim, rng);
+                }
+                else
+                {
+                    for (int i = 0; i < n; ++i) next[i] = w[i] / beta[j];
+                }
+            }
+
+            if (failed || !_vectors())
+            {
+                _sigma.assign(k, 0.);
+                _sign.assign(k, 1.);
+                _y.assign((size_t) n * k, 0.);
+                return -2;
+            }
+            return converged ? dim : -1;
+        }
+
+        int size() const { return n; }
+        int rank() const { return k; }
+
+        const double * sigma() const { return _sigma.data(); }
+        /* the column-major Ritz vectors, `v[i][c]` */
+        double v(int i, int c) const { return _y[(size_t) c * n + i]; }
+        double u(int i, int c) const { return _sign[c] * _y[(size_t) c * n + i]; }
+        /* the signed eigenvalue `lambda[c]` */
+        double eigenvalue(int c) const { return _sign[c] * _sigma[c]; }
+
+        /**
+         * Writes row-major `n x k` `u` and `v` (the
+         * `svd_toepliz` layout truncated to `k` columns);
+         * any of the pointers may be null.
+         */
+        void copy_to(double * u, double * v, double * sigma) const
+        {
+            for (int i = 0; i < n; ++i)
+            for (int c = 0; c < k; ++c)
+            {
+                if (u != nullptr) u[(size_t) i * k + c] = this->u(i, c);
+                if (v != nullptr) v[(size_t) i * k + c] = this->v(i, c);
+            }
+            if (sigma != nullptr) std::copy(_sigma.begin(), _sigma.end(), sigma);
+        }
+
+    private:
+
+        toeplitz_lanczos(const toeplitz_lanczos &);
+        toeplitz_lanczos & operator = (const toeplitz_lanczos &);
+
+        double _dot(const double * x, const double * y) const
+        {
+            double s = 0;
+            for (int i = 0; i < n; ++i) s += x[i] * y[i];
+            return s;
+        }
+
+        /* the largest |alpha| + 2 |beta|, a lower bound of |T| */
+        double _norm_estimate(int count) const
+        {
+            double r = 0;
+            for (int j = 0; j < count; ++j)
+            {
+                r = (std::max)(r, std::abs(alpha[j]) + 2 * std::abs(beta[j]));
+            }
+            return r;
+        }
+
+        /* removes the first `count` basis vectors from `x`
+           (classical Gram-Schmidt twice), returns |x| */
+        double _orthogonalize(double * x, int count) const
+        {
+            for (int pass = 0; pass < 2; ++pass)
+            for (int j = 0; j < count; ++j)
+            {
+                const double * q = basis.data() + (size_t) j * n;
+                double c = _dot(q, x);
+                for (int i = 0; i < n; ++i) x[i] -= c * q[i];
+            }
+            return std::sqrt(_dot(x, x));
+        }
+
+        /* a random unit vector orthogonal to the first `j` */
+        void _start(int j, xoshiro256 & rng)
+        {
+            double * q = basis.data() + (size_t) j * n;
+            double s;
+            do
+            {
+                for (int i = 0; i < n; ++i) q[i] = rng.uniform() - 0.5;
+                s = _orthogonalize(q, j);
+            } while (!(s > 0));
+            for (int i = 0; i < n; ++i) q[i] /= s;
+        }
+
+        /* eigen-decomposes the `dim x dim` tridiagonal matrix
+           and orders the Ritz values by descending magnitude;
+           `z` holds the last `rows` rows of the eigenvectors */
+        bool _ritz(int rows)
+        {
+            d.assign(alpha.begin(), alpha.begin() + dim);
+            e.assign(beta.begin(), beta.begin() + dim);
+            z.resize((size_t) rows * dim);
+            if (!tridiagonal_eigen(d.data(), e.data(), z.data(), dim, rows)) return false;
+
+            _order.resize(dim);
+            for (int c = 0; c < dim; ++c) _order[c] = c;
+            const std::vector < double > & l = d;
+            std::stable_sort(_order.begin(), _order.end(),
+                             [&l] (int a, int b) { return std::abs(l[a]) > std::abs(l[b]); });
+
+            _sigma.resize(k);
+            _sign.resize(k);
+            for (int c = 0; c < k; ++c)
+            {
+                double lambda = d[_order[c]];
+                _sigma[c] = std::abs(lambda);
+                _sign[c] = (lambda < 0) ? -1. : 1.;
+            }
+            return true;
+        }
+
+        /* the residual of the Ritz pair is |beta z[dim - 1][c]| */
+        bool _converged(double tolerance)
+        {
+            bool all = true;
+            for (int c = 0; c < k; ++c)
+            {
+                double residual = std::abs(beta[dim - 1] * z[_order[c]]);
+                all = all && (residual <= tolerance * _sigma[0]);
+            }
+            return all;
+        }
+
+        /* y = Q z for the leading `k` Ritz pairs */
+        bool _vectors()
+        {
+            _y.assign((size_t) n * k, 0.);
+            if (!_ritz(dim)) return false;
+            for (int c = 0; c < k; ++c)
+            {
+                double * y = _y.data() + (size_t) c * n;
+                for (int j = 0; j < dim; ++j)
+                {
+                    const double * q = basis.data() + (size_t) j * n;
+                    double f = z[(size_t) j * dim + _order[c]];
+                    for (int i = 0; i < n; ++i) y[i] += f * q[i];
+                }
+            }
+            return true;
+        }
+    };
+}
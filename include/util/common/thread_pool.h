@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+namespace util
+{
+
+    /*****************************************************/
+    /*                   thread_pool                     */
+    /*****************************************************/
+
+    /**
+     * Fixed set of worker threads executing indexed tasks.
+     *
+     * `run(tasks, fn)` calls `fn(task, worker)` for every
+     * `task` in `[0, tasks)` and blocks until all of them
+     * complete. The calling thread takes part in the work
+     * as the worker `0`, so `worker` is always less than
+     * `size()` and may be used to index per-worker state
+     * (e.g. scratch buffers) without synchronization.
+     *
+     * Concurrent `run` calls are serialized; calling `run`
+     * from inside a task deadlocks. The first exception
+     * thrown by a task is rethrown by `run`.
+     */
+    class thread_pool
+    {
+
+    private:
+
+        using task_t = std::function < void (size_t task, size_t worker) > ;
+
+        std::vector < std::thread > threads;
+
+        std::mutex run_mutex;
+
+        std::mutex mutex;
+        std::condition_variable wake, done;
+
+        const task_t * job;
+        size_t job_tasks;
+        std::atomic < size_t > next;
+        size_t active;
+        unsigned long generation;
+        bool stop;
+        std::exception_ptr error;
+
+    public:
+
+        explicit thread_pool(size_t workers = std::thread::hardware_concurrency())
+            : job(nullptr)
+            , job_tasks(0)
+            , active(0)
+            , generation(0)
+            , stop(false)
+        {
+            next = 0;
+            if (workers == 0) workers = 1;
+            for (size_t w = 1; w < workers; ++w)
+            {
+                threads.emplace_back(&thread_pool::_worker, this, w);
+            }
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard < std::mutex > lock(mutex);
+                stop = true;
+            }
+            wake.notify_all();
+            for (size_t w = 0; w < threads.size(); ++w) threads[w].join();
+        }
+
+        size_t size() const { return threads.size() + 1; }
+
+        void run(size_t tasks, const task_t & fn)
+        {
+            if (tasks == 0) return;
+
+            std::lock_guard < std::mutex > run_lock(run_mutex);
+
+            if (threads.empty() || (tasks == 1))
+            {
+                for (size_t t = 0; t < tasks; ++t) fn(t, 0);
+                return;
+            }
+
+            {
+                std::lock_guard < std::mutex > lock(mutex);
+                job = &fn;
+                job_tasks = tasks;
+                next = 0;
+                active = threads.size();
+                error = nullptr;
+                ++generation;
+            }
+            wake.notify_all();
+
+            _drain(0);
+
+            std::exception_ptr e;
+            {
+                std::unique_lock < std::mutex > lock(mutex);
+                while (active != 0) done.wait(lock);
+                job = nullptr;
+                e = error;
+                error = nullptr;
+            }
+            if (e) std::rethrow_exception(e);
+        }
+
+    private:
+
+        thread_pool(const thread_pool &);
+        thread_pool & operator = (const thread_pool &);
+
+        void _drain(size_t worker)
+        {
+            for (;;)
+            {
+                size_t t = next++;
+                if (t >= job_tasks) return;
+                try
+                {
+                    (*job)(t, worker);
+                }
+                catch (...)
+                {
+                    std::lock_guard < std::mutex > lock(mutex);
+                    if (!error) error = std::current_exception();
+                    next = job_tasks;
+                }
+            }
+        }
+
+        void _worker(size_t worker)
+        {
+            unsigned long seen = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock < std::mutex > lock(mutex);
+                    while (!stop && (generation == seen)) wake.wait(lock);
+                    if (stop) return;
+                    seen = generation;
+                }
+
+                _drain(worker);
+
+                {
+                    std::lock_guard < std::mutex > lock(mutex);
+                    if (--active == 0) done.notify_all();
+                }
+            }
+        }
+    };
+}
@@ -29,33 +29,29 @@
 #include "stdafx.h"
 #include <util/common/math/rpoly.h>
 
-void quad(double a,double b1,double c,double *sr,double *si,
+static void quad(double a,double b1,double c,double *sr,double *si,
         double *lr,double *li);
-void fxshfr(int l2, int *nz);
-void quadit(double *uu,double *vv,int *nz);
-void realit(double sss, int *nz, int *iflag);
-void calcsc(int *type);
-void nextk(int *type);
-void newest(int type,double *uu,double *vv);
-void quadsd(int n,double *u,double *v,double *p,double *q,
+static void quadsd(int n,double *u,double *v,double *p,double *q,
         double *a,double *b);
-double *p,*qp,*k,*qk,*svk;
-double sr,si,u,v,a,b,c,d,a1,a2;
-double a3,a6,a7,e,f,g,h,szr,szi,lzr,lzi;
-double eta,are,mre;
-int n,nn,nmi,zerok;
-static int itercnt;
 
-int rpoly(double *op, int degree, double *zeror, double *zeroi) 
+rpoly_context::rpoly_context()
+    : p(0), qp(0), k(0), qk(0), svk(0), itercnt(0)
+{
+}
+
+int rpoly(double *op, int degree, double *zeror, double *zeroi)
+{
+    rpoly_context context;
+    return context.solve(op, degree, zeror, zeroi);
+}
+
+int rpoly_context::solve(const double *op, int degree, double *zeror, double *zeroi)
 {
     double t,aa,bb,cc,*temp,factor,rot;
     double *pt;
     double lo,max,min,xx,yy,cosr,sinr,xxx,x,sc,bnd;
     double xm,ff,df,dx,infin,smalno,base;
     int cnt,nz,i,j,jj,l,nm1,zerok;
-    long sec;
-
-    sec = clock();
 
 /*  The following statements set machine constants. */
     base = 2.0;
@@ -74,6 +70,7 @@ int rpoly(double *op, int degree, double *zeror, double *zeroi)
     cosr = cos(rot);
     sinr = sin(rot);
     n = degree;
+    itercnt = 0;
 /*  Algorithm fails of the leading coefficient is zero. */
     if (op[0] == 0.0) return -1;
 /*  Remove the zeros at the origin, if any. */
@@ -85,21 +82,23 @@ int rpoly(double *op, int degree, double *zeror, double *zeroi)
     }
     if (n < 1) return degree;
 /*
- *  Allocate memory here
+ *  Take the working vectors from the context buffer, which
+ *  only grows, so solves of the same degree do not allocate.
  */
-    temp = new double [degree+1];
-    pt = new double [degree+1];
-    p = new double [degree+1];
-    qp = new double [degree+1];
-    k = new double [degree+1];
-    qk = new double [degree+1];
-    svk = new double [degree+1];
+    if (buffer.size() < 7 * (size_t)(degree+1))
+        buffer.resize(7 * (size_t)(degree+1));
+    temp = &buffer[0];
+    pt = temp + (degree+1);
+    p = pt + (degree+1);
+    qp = p + (degree+1);
+    k = qp + (degree+1);
+    qk = k + (degree+1);
+    svk = qk + (degree+1);
 /*  Make a copy of the coefficients. */
     for (i=0;i<=n;i++)
         p[i] = op[i];
 /*  Start the algorithm for one zero. */
 _40:        
-    itercnt = 0;
     if (n == 1) {
         zeror[degree-1] = -p[1]/p[0];
         zeroi[degree-1] = 0.0;
@@ -258,14 +257,6 @@ _110:
     } 
 /*  Return with failure if no convergence after 20 shifts. */
 _99:
-    delete [] svk;
-    delete [] qk;
-    delete [] k;
-    delete [] qp;
-    delete [] p;
-    delete [] pt;
-    delete [] temp;
-
     return degree - n;
 }
 /*  Computes up to L2 fixed shift k-polynomials,
@@ -274,7 +265,7 @@ _99:
  *  iterations and returns with the number of zeros
  *  found.
  */
-void fxshfr(int l2,int *nz)
+void rpoly_context::fxshfr(int l2,int *nz)
 {
     double svu,svv,ui,vi,s;
     double betas,betav,oss,ovv,ss,vv,ts,tv;
@@ -387,7 +378,7 @@ _70:
  *  uu, vv - coefficients of starting quadratic.
  *  nz - number of zeros found.
  */
-void quadit(double *uu,double *vv,int *nz)
+void rpoly_context::quadit(double *uu,double *vv,int *nz)
 {
     double ui,vi;
     double mp,omp,ee,relstp,t,zm;
@@ -469,7 +460,7 @@ _50:
  *  nz  - number of zeros found
  *  iflag - flag to indicate a pair of zeros near real axis.
  */
-void realit(double sss, int *nz, int *iflag)
+void rpoly_context::realit(double sss, int *nz, int *iflag)
 {
     double pv,kv,t,s;
     double ms,mp,omp,ee;
@@ -558,7 +549,7 @@ _50:
  *  type - integer variable set here indicating how the
  *  calculations are normalized to avoid overflow.
  */
-void calcsc(int *type)
+void rpoly_context::calcsc(int *type)
 {
 /*  Synthetic division of k by the quadratic 1,u,v */    
     quadsd(n-1,&u,&v,k,qk,&c,&d);
@@ -593,7 +584,7 @@ _10:
 /*  Computes the next k polynomials using scalars 
  *  computed in calcsc.
  */
-void nextk(int *type)
+void rpoly_context::nextk(int *type)
 {
     double temp;
 	int i;
@@ -631,7 +622,7 @@ void nextk(int *type)
 /*  Compute new estimates of the quadratic coefficients
  *  using the scalars computed in calcsc.
  */
-void newest(int type,double *uu,double *vv)
+void rpoly_context::newest(int type,double *uu,double *vv)
 {
     double a4,a5,b1,b2,c1,c2,c3,c4,temp;
 
@@ -671,7 +662,7 @@ void newest(int type,double *uu,double *vv)
 /*  Divides p by the quadratic 1,u,v placing the quotient
  *  in q and the remainder in a,b.
  */
-void quadsd(int nn,double *u,double *v,double *p,double *q,
+static void quadsd(int nn,double *u,double *v,double *p,double *q,
     double *a,double *b)
 {
     double c;
@@ -694,7 +685,7 @@ void quadsd(int nn,double *u,double *v,double *p,double *q,
  *  are complex. The smaller real zero is found directly from 
  *  the product of the zeros c/a.
  */
-void quad(double a,double b1,double c,double *sr,double *si,
+static void quad(double a,double b1,double c,double *sr,double *si,
         double *lr,double *li)
 {
     double b,d,e;
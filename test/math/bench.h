@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+namespace math
+{
+
+    /**
+     * Runs `fn` until at least `budget` seconds pass
+     * and returns the mean time of a single run (us).
+     *
+     * Shared by the ignored benchmark methods of the
+     * test classes.
+     */
+    inline double bench(const std::function < void () > & fn, double budget = 0.25)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        size_t runs = 0;
+        auto start = clock::now();
+        double elapsed;
+        do
+        {
+            fn(); ++runs;
+            elapsed = std::chrono::duration < double > (clock::now() - start).count();
+        } while (elapsed < budget);
+        return elapsed / runs * 1e6;
+    }
+}
@@ -0,0 +1,255 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cstdio>
+#include <vector>
+#include <fstream>
+
+#include <util/common/math/capture.h>
+
+#ifdef _WIN32
+    #include <winioctl.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static const char * capture_test_path = "capture_test.ucap";
+
+    /* grows the file to `size` bytes without writing them */
+    static bool extend_sparse(const char * path, uint64_t size)
+    {
+    #ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        DWORD bytes;
+        LARGE_INTEGER li;
+        li.QuadPart = (LONGLONG) size;
+        bool ok = DeviceIoControl(file, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytes, NULL)
+            && SetFilePointerEx(file, li, NULL, FILE_BEGIN)
+            && SetEndOfFile(file);
+        CloseHandle(file);
+        return ok;
+    #else
+        return truncate(path, (off_t) size) == 0;
+    #endif
+    }
+
+    TEST_CLASS(capture_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_write_append_view)
+            TEST_DESCRIPTION(L"appended blocks are read back through a zero-copy view and chunks")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_write_append_view)
+        {
+            std::vector < double > data(1000);
+            for (size_t i = 0; i < data.size(); ++i) data[i] = i * 0.5;
+            {
+                capture_writer w(capture_test_path, 0.1);
+                Assert::IsTrue(w.is_open(), L"create", LINE_INFO());
+                sampled_t block = { data.data(), 600, 0.1 };
+                Assert::IsTrue(w.write(block), L"write", LINE_INFO());
+            }
+            {
+                capture_writer w(capture_test_path, 0.1, 1, capture_float64, true);
+                Assert::AreEqual((uint64_t) 600, w.count(), L"append count", LINE_INFO());
+                Assert::IsTrue(w.write(data.data() + 600, 400), L"append", LINE_INFO());
+                Assert::IsFalse(capture_writer(capture_test_path, 0.2, 1, capture_float64, true).is_open(),
+                                L"mismatched period", LINE_INFO());
+            }
+
+            capture_reader r(capture_test_path);
+            Assert::IsTrue(r.is_open(), L"open", LINE_INFO());
+            sampled_t view;
+            Assert::IsTrue(r.view(view), L"view", LINE_INFO());
+            Assert::AreEqual(data.size(), view.count, L"count", LINE_INFO());
+            Assert::AreEqual(0.1, view.period, 0., L"period", LINE_INFO());
+            for (size_t i = 0; i < data.size(); ++i) Assert::AreEqual(data[i], view.samples[i], 0., L"sample", LINE_INFO());
+
+            capture_cursor c = r.chunks(300);
+            sampled_t chunk;
+            size_t total = 0, n_chunks = 0;
+            while (c.next(chunk))
+            {
+                for (size_t i = 0; i < chunk.count; ++i)
+                    Assert::AreEqual(data[total + i], chunk.samples[i], 0., L"chunk sample", LINE_INFO());
+                total += chunk.count; ++n_chunks;
+            }
+            Assert::AreEqual((size_t) 1000, total, L"chunks total", LINE_INFO());
+            Assert::AreEqual((size_t) 4, n_chunks, L"chunk count", LINE_INFO());
+
+            r.close();
+
+            /* a payload offset that would misalign the samples */
+            {
+                uint64_t header_size = sizeof(capture_header) + 4;
+                std::fstream f(capture_test_path, std::ios::in | std::ios::out | std::ios::binary);
+                f.seekp((std::streamoff) offsetof(capture_header, header_size));
+                f.write((const char *) &header_size, sizeof(header_size));
+            }
+            Assert::IsFalse(capture_reader(capture_test_path).is_open(), L"misaligned payload", LINE_INFO());
+
+            std::remove(capture_test_path);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_sliding_window)
+            TEST_DESCRIPTION(L"small cursor windows slide over unaligned chunk offsets")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_sliding_window)
+        {
+            std::vector < double > data(20000);
+            for (size_t i = 0; i < data.size(); ++i) data[i] = i * 0.25;
+            {
+                capture_writer w(capture_test_path, 0.1);
+                w.write(data.data(), data.size());
+            }
+
+            capture_reader r(capture_test_path);
+            for (size_t frames = 1; frames <= 4097; frames += 1024)
+            {
+                capture_cursor c(r, frames, 0, 1000);
+                sampled_t chunk;
+                size_t total = 0;
+                while (c.next(chunk))
+                {
+                    Assert::AreEqual(data[total], chunk.samples[0], 0., L"first", LINE_INFO());
+                    Assert::AreEqual(data[total + chunk.count - 1], chunk.samples[chunk.count - 1], 0., L"last", LINE_INFO());
+                    total += chunk.count;
+                }
+                Assert::AreEqual(data.size(), total, L"total", LINE_INFO());
+            }
+
+            r.close();
+            std::remove(capture_test_path);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_over_4gb)
+            TEST_DESCRIPTION(L"captures with more than 2^32 / 8 frames open and iterate to the end")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_over_4gb)
+        {
+            uint64_t frames = ((uint64_t) 1 << 29) + 4099;
+            double first = 1.5, last = 2.5;
+            {
+                capture_writer w(capture_test_path, 0.1);
+                w.write(&first, 1);
+            }
+            Assert::IsTrue(extend_sparse(capture_test_path, sizeof(capture_header) + frames * sizeof(double)),
+                           L"sparse file", LINE_INFO());
+            {
+                std::fstream f(capture_test_path, std::ios::in | std::ios::out | std::ios::binary);
+                f.seekp((std::streamoff) offsetof(capture_header, count));
+                f.write((const char *) &frames, sizeof(frames));
+                f.seekp((std::streamoff) (sizeof(capture_header) + (frames - 1) * sizeof(double)));
+                f.write((const char *) &last, sizeof(last));
+                Assert::IsTrue((bool) f, L"patch", LINE_INFO());
+            }
+
+            capture_reader r(capture_test_path);
+            Assert::IsTrue(r.is_open(), L"open", LINE_INFO());
+            Assert::AreEqual(frames, r.count(), L"count", LINE_INFO());
+
+            /* only the first and the last chunks are touched */
+            capture_cursor c = r.chunks((size_t) 1 << 22);
+            sampled_t chunk;
+            uint64_t total = 0;
+            while (c.next(chunk))
+            {
+                if (total == 0) Assert::AreEqual(first, chunk.samples[0], 0., L"first", LINE_INFO());
+                total += chunk.count;
+                Assert::AreEqual(total, c.position(), L"position", LINE_INFO());
+            }
+            Assert::AreEqual(frames, total, L"total", LINE_INFO());
+            Assert::AreEqual(last, chunk.samples[chunk.count - 1], 0., L"last", LINE_INFO());
+
+            r.close();
+            std::remove(capture_test_path);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_copy_on_write)
+            TEST_DESCRIPTION(L"writes into views and chunks do not reach the file")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_copy_on_write)
+        {
+            std::vector < double > data(1000, 1.);
+            {
+                capture_writer w(capture_test_path, 0.1);
+                w.write(data.data(), data.size());
+            }
+            {
+                capture_reader r(capture_test_path);
+                sampled_t view, chunk;
+                Assert::IsTrue(r.view(view), L"view", LINE_INFO());
+                view.samples[0] = 2;
+                capture_cursor c = r.chunks(100);
+                Assert::IsTrue(c.next(chunk), L"chunk", LINE_INFO());
+                Assert::AreEqual(1., chunk.samples[0], 0., L"private view", LINE_INFO());
+                chunk.samples[1] = 3;
+            }
+
+            capture_reader r(capture_test_path);
+            sampled_t view;
+            Assert::IsTrue(r.view(view), L"view", LINE_INFO());
+            Assert::AreEqual(1., view.samples[0], 0., L"file untouched by view", LINE_INFO());
+            Assert::AreEqual(1., view.samples[1], 0., L"file untouched by chunk", LINE_INFO());
+
+            r.close();
+            std::remove(capture_test_path);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_multichannel_float32)
+            TEST_DESCRIPTION(L"interleaved float32 captures are converted per channel")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_multichannel_float32)
+        {
+            std::vector < double > frames(3 * 500);
+            for (size_t i = 0; i < 500; ++i)
+            for (size_t c = 0; c < 3; ++c)
+                frames[i * 3 + c] = c * 1000. + i;
+            {
+                capture_writer w(capture_test_path, 1., 3, capture_float32);
+                w.write(frames.data(), 200);
+                w.flush();
+
+                /* the flushed part is visible while writing */
+                capture_reader partial(capture_test_path);
+                Assert::AreEqual((uint64_t) 200, partial.count(), L"flushed count", LINE_INFO());
+                partial.close();
+
+                w.write(frames.data() + 600, 300);
+            }
+
+            capture_reader r(capture_test_path);
+            sampled_t view;
+            Assert::IsFalse(r.view(view), L"no zero-copy view", LINE_INFO());
+            Assert::AreEqual((uint64_t) 500, r.count(), L"count", LINE_INFO());
+            for (size_t c = 0; c < 3; ++c)
+            {
+                capture_cursor cursor = r.chunks(128, c);
+                sampled_t chunk;
+                size_t i = 0;
+                while (cursor.next(chunk))
+                {
+                    for (size_t j = 0; j < chunk.count; ++j, ++i)
+                    {
+                        Assert::AreEqual(c * 1000. + i, chunk.samples[j], 0., L"sample", LINE_INFO());
+                    }
+                }
+                Assert::AreEqual((size_t) 500, i, L"total", LINE_INFO());
+            }
+
+            r.close();
+            std::remove(capture_test_path);
+        }
+    };
+}
@@ -0,0 +1,170 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/convolution.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static std::vector < double > make_real_signal(size_t n)
+    {
+        std::vector < double > data(n);
+        srand((unsigned) n + 1);
+        for (size_t i = 0; i < n; ++i) data[i] = random();
+        return data;
+    }
+
+    static sampled_t as_sampled(std::vector < double > & data)
+    {
+        sampled_t s = { data.data(), data.size(), 1 };
+        return s;
+    }
+
+    static double max_error(const std::vector < double > & a, const std::vector < double > & b, size_t n)
+    {
+        double e = 0;
+        for (size_t i = 0; i < n; ++i) e = (std::max)(e, std::abs(a[i] - b[i]));
+        return e;
+    }
+
+    TEST_CLASS(convolution_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_cyclic_matches_direct)
+            TEST_DESCRIPTION(L"cyclic convolution matches the direct one for even and odd lengths")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_cyclic_matches_direct)
+        {
+            size_t sizes[] = { 1, 7, 33, 100, 255, 256, 1000, 1001 };
+            for (size_t n : sizes)
+            {
+                auto f = make_real_signal(n), g = make_real_signal(n + 1);
+                g.resize(n);
+                std::vector < double > expected(n), actual(n);
+                sampled_t sf = as_sampled(f), sg = as_sampled(g);
+                sampled_t se = as_sampled(expected), sa = as_sampled(actual);
+
+                double p1 = convolve(sf, sg, se);
+                double p2 = convolve(sf, sg, sa, cyclic_convolution);
+
+                Assert::IsTrue(max_error(expected, actual, n) < 1e-9 * n, L"samples", LINE_INFO());
+                Assert::IsTrue(std::abs(p1 - p2) < 1e-9 * (1 + p1), L"power", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_cyclic_awkward_lengths)
+            TEST_DESCRIPTION(L"cyclic convolution prices Bluestein lengths and reuses cached plans")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_cyclic_awkward_lengths)
+        {
+            Assert::IsTrue(_is_fft_fast_size(1000), L"smooth", LINE_INFO());
+            Assert::IsFalse(_is_fft_fast_size(1009), L"prime", LINE_INFO());
+
+            /* a prime length costs about three transforms of
+               fft_fast_size(2 n) points, a smooth one just n */
+            size_t m = 1200;
+            while (_prefer_fft_convolution(m, m, m, m)) --m;
+            size_t p = m + 1;
+            while (_is_fft_fast_size(p)) ++p;
+            size_t nfft = fft_fast_size(2 * p);
+            Assert::IsFalse(_prefer_fft_convolution(p, p, 3 * nfft, nfft), L"crossover", LINE_INFO());
+
+            size_t sizes[] = { 1009, 1009, 4099 };
+            for (size_t n : sizes)
+            {
+                auto f = make_real_signal(n), g = make_real_signal(n + 1);
+                g.resize(n);
+                std::vector < double > expected(n), actual(n);
+                sampled_t sf = as_sampled(f), sg = as_sampled(g);
+                sampled_t se = as_sampled(expected), sa = as_sampled(actual);
+
+                convolve(sf, sg, se);
+                convolve(sf, sg, sa, cyclic_convolution);
+
+                Assert::IsTrue(max_error(expected, actual, n) < 1e-9 * n, L"samples", LINE_INFO());
+            }
+
+            auto p1 = _get_convolution_plans(1009), p2 = _get_convolution_plans(1009);
+            Assert::IsTrue(p1 == p2, L"cached", LINE_INFO());
+            for (size_t i = 0; i < convolution_plan_cache_size(); ++i)
+            {
+                _get_convolution_plans(2 * i + 2);
+            }
+            Assert::IsTrue(p1 != _get_convolution_plans(1009), L"evicted", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_linear_matches_direct)
+            TEST_DESCRIPTION(L"linear convolution matches the zero-padded direct sum")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_linear_matches_direct)
+        {
+            size_t sizes[][2] = { { 1, 1 }, { 10, 3 }, { 3, 10 }, { 200, 150 },
+                                  { 5000, 31 }, { 4000, 64 }, { 77, 3000 } };
+            for (auto & s : sizes)
+            {
+                auto f = make_real_signal(s[0]), g = make_real_signal(s[1]);
+                size_t len = s[0] + s[1] - 1;
+                std::vector < double > expected(len, 0.), actual(len);
+                for (size_t i = 0; i < s[0]; ++i)
+                for (size_t j = 0; j < s[1]; ++j)
+                    expected[i + j] += f[i] * g[j];
+
+                sampled_t sf = as_sampled(f), sg = as_sampled(g), sa = as_sampled(actual);
+                convolve(sf, sg, sa, linear_convolution);
+
+                Assert::IsTrue(max_error(expected, actual, len) < 1e-9 * len, L"samples", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_mapper_and_power)
+            TEST_DESCRIPTION(L"mapper is applied before the power is accumulated")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_mapper_and_power)
+        {
+            auto f = make_real_signal(512), g = make_real_signal(512);
+            std::vector < double > out(512);
+            sampled_t sf = as_sampled(f), sg = as_sampled(g), so = as_sampled(out);
+            double power = convolve(sf, sg, so, cyclic_convolution,
+                                    [] (size_t i, double) { return (double) (i % 2); });
+            Assert::AreEqual(1., out[1], 0., L"odd", LINE_INFO());
+            Assert::AreEqual(0., out[2], 0., L"even", LINE_INFO());
+            Assert::AreEqual(256., power, 0., L"power", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_ola_streaming)
+            TEST_DESCRIPTION(L"ola_convolver fed in uneven chunks matches the linear convolution")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_ola_streaming)
+        {
+            auto f = make_real_signal(3000), h = make_real_signal(45);
+            size_t len = f.size() + h.size() - 1;
+            std::vector < double > expected(len), actual(len);
+            _convolve_linear_direct(f.data(), f.size(), h.data(), h.size(), expected.data());
+
+            ola_convolver ola(h.data(), h.size(), 100);
+            size_t chunks[] = { 1, 17, 250, 3, 1000, 44 };
+            size_t pos = 0;
+            for (size_t i = 0; pos < f.size(); i = (i + 1) % 6)
+            {
+                size_t c = (std::min)(chunks[i], f.size() - pos);
+                ola.process(f.data() + pos, c, actual.data() + pos);
+                pos += c;
+            }
+            ola.flush(actual.data() + pos);
+
+            Assert::IsTrue(max_error(expected, actual, len) < 1e-9, L"samples", LINE_INFO());
+        }
+    };
+}
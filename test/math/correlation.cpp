@@ -0,0 +1,139 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/correlation.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static std::vector < double > make_noise(size_t n, unsigned seed)
+    {
+        std::vector < double > data(n);
+        srand(seed);
+        for (size_t i = 0; i < n; ++i) data[i] = random();
+        return data;
+    }
+
+    static std::vector < double > make_pulse(size_t n, double center, double width)
+    {
+        std::vector < double > data(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            double t = (i - center) / width;
+            data[i] = std::exp(- t * t / 2);
+        }
+        return data;
+    }
+
+    static sampled_t view(std::vector < double > & data)
+    {
+        sampled_t s = { data.data(), data.size(), 1 };
+        return s;
+    }
+
+    TEST_CLASS(correlation_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_autocorrelation)
+            TEST_DESCRIPTION(L"fast_autocorrelation matches autocorrelation")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_autocorrelation)
+        {
+            auto x = make_noise(301, 1);
+            std::vector < double > expected(120), actual(120);
+            sampled_t sx = view(x), se = view(expected), sa = view(actual);
+            autocorrelation(sx, se);
+            fast_autocorrelation(sx, sa);
+            for (size_t k = 0; k < expected.size(); ++k)
+            {
+                Assert::AreEqual(expected[k], actual[k], 1e-10, L"lag", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_cyclic_correlation)
+            TEST_DESCRIPTION(L"fast_correlation matches correlation, incl. reflected and negative sequences")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_cyclic_correlation)
+        {
+            size_t sizes[] = { 1, 16, 45, 128 };
+            for (size_t n : sizes)
+            for (int reflect = 0; reflect < 2; ++reflect)
+            {
+                auto x1 = make_noise(n, 2), x2 = make_noise(n, 3);
+                /* all-negative correlation exercises the maximum search */
+                for (size_t i = 0; i < n; ++i) { x1[i] = std::abs(x1[i]) + 1; x2[i] = - std::abs(x2[i]) - 1; }
+                std::vector < double > expected(n), actual(n);
+                sampled_t s1 = view(x1), s2 = view(x2), se = view(expected), sa = view(actual);
+                auto m1 = correlation(s1, s2, se, reflect != 0);
+                auto m2 = fast_correlation(s1, s2, sa, reflect != 0);
+                for (size_t k = 0; k < n; ++k)
+                {
+                    Assert::AreEqual(expected[k], actual[k], 1e-10, L"lag", LINE_INFO());
+                    Assert::IsTrue(expected[k] <= m1.second, L"legacy max", LINE_INFO());
+                }
+                Assert::IsTrue(m1.second < 0, L"negative max", LINE_INFO());
+                Assert::AreEqual(m1.second, expected[m1.first], 0., L"legacy argmax", LINE_INFO());
+                Assert::AreEqual(m1.second, m2.second, 1e-10, L"max", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_cross_correlation)
+            TEST_DESCRIPTION(L"cross_correlation matches the full-lag direct sum")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_cross_correlation)
+        {
+            auto x1 = make_noise(70, 4), x2 = make_noise(500, 5);
+            size_t n1 = x1.size(), n2 = x2.size();
+            std::vector < double > actual(n1 + n2 - 1), reflected(n1 + n2 - 1);
+            sampled_t s1 = view(x1), s2 = view(x2), sa = view(actual), sr = view(reflected);
+            cross_correlation(s1, s2, sa);
+            cross_correlation(s1, s2, sr, true);
+            for (ptrdiff_t k = - (ptrdiff_t) n1 + 1; k < (ptrdiff_t) n2; ++k)
+            {
+                double r = 0, c = 0;
+                for (ptrdiff_t i = 0; i < (ptrdiff_t) n1; ++i)
+                {
+                    if ((i + k >= 0) && (i + k < (ptrdiff_t) n2)) r += x1[i] * x2[i + k];
+                    ptrdiff_t j = k + (ptrdiff_t) n1 - 1 - i;
+                    if ((j >= 0) && (j < (ptrdiff_t) n2)) c += x1[i] * x2[j];
+                }
+                Assert::AreEqual(r, actual[k + lag_origin(s1)], 1e-9, L"lag", LINE_INFO());
+                Assert::AreEqual(c, reflected[k + lag_origin(s1)], 1e-9, L"reflected", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_top_lags)
+            TEST_DESCRIPTION(L"top_lags refines the delay of a shifted pulse to a sub-sample lag")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_top_lags)
+        {
+            /* two pulses, the second one is weaker */
+            auto x1 = make_pulse(256, 100, 4);
+            auto x2 = make_pulse(256, 110.3, 4);
+            auto echo = make_pulse(256, 60.6, 4);
+            for (size_t i = 0; i < x2.size(); ++i) x2[i] += 0.5 * echo[i];
+
+            std::vector < double > r(x1.size() + x2.size() - 1);
+            sampled_t s1 = view(x1), s2 = view(x2), sr = view(r);
+            cross_correlation(s1, s2, sr);
+            auto peaks = top_lags(sr, 2, false, lag_origin(s1));
+
+            Assert::AreEqual((size_t) 2, peaks.size(), L"count", LINE_INFO());
+            Assert::AreEqual(10.3, peaks[0].lag, 0.05, L"main lag", LINE_INFO());
+            Assert::AreEqual(-39.4, peaks[1].lag, 0.05, L"echo lag", LINE_INFO());
+            Assert::IsTrue(peaks[0].value >= r[peaks[0].index], L"refined value", LINE_INFO());
+        }
+    };
+}
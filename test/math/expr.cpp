@@ -0,0 +1,112 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/expr.h>
+#include <util/common/math/sampled_buffer.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static sampled_t make_sampled(std::vector < double > & data, unsigned seed)
+    {
+        srand(seed);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = random();
+        sampled_t s = { data.data(), data.size(), 0.1 };
+        return s;
+    }
+
+    TEST_CLASS(expr_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_map_overloads)
+            TEST_DESCRIPTION(L"templated map and the std::function compatibility overloads agree")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_map_overloads)
+        {
+            std::vector < double > a(100), b(100), c(100);
+            sampled_t sa = make_sampled(a, 1), sb = make_sampled(b, 2), sc = make_sampled(c, 1);
+
+            bi_op_t legacy = mult_add_op(3);
+            map(sa, sb, legacy);
+            map(sc, sb, mult_add_op(3));
+            for (size_t i = 0; i < a.size(); ++i) Assert::AreEqual(a[i], c[i], 0., L"bi op", LINE_INFO());
+
+            un_op_t legacy_un = [] (size_t i, double v) { return v * i; };
+            map(sa, legacy_un);
+            map(sc, [] (size_t i, double v) { return v * i; });
+            for (size_t i = 0; i < a.size(); ++i) Assert::AreEqual(a[i], c[i], 0., L"un op", LINE_INFO());
+
+            map(sa, sb);
+            for (size_t i = 0; i < a.size(); ++i) Assert::AreEqual(b[i], a[i], 0., L"identity", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_map_sampled_buffer)
+            TEST_DESCRIPTION(L"map on sampled_buffer arguments resolves to the sampled_t overloads")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_map_sampled_buffer)
+        {
+            sampled_buffer a(100, 0.1), b(100, 0.1);
+            for (size_t i = 0; i < b.count(); ++i) { a[i] = 0; b[i] = (double) i; }
+
+            map(a, b);
+            for (size_t i = 0; i < a.count(); ++i) Assert::AreEqual(b[i], a[i], 0., L"identity", LINE_INFO());
+
+            map(a, b, mult_add_op(2));
+            map(a, [] (size_t, double v) { return v + 1; });
+            for (size_t i = 0; i < a.count(); ++i) Assert::AreEqual(3. * i + 1, a[i], 0., L"ops", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_combine_overloads)
+            TEST_DESCRIPTION(L"combine accepts both std::function and plain combiners")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_combine_overloads)
+        {
+            continuous_t funcs[] = { sin(1, 1), [] (double t) { return t; } };
+            continuous_t sum = combine(2, funcs);
+            continuous_t prod = combine(2, funcs, [] (size_t, double d, double s) { return d * s; });
+            bi_op_t legacy = mult_add_op(2);
+            continuous_t scaled = combine(2, funcs, legacy);
+            double t = 0.3;
+            Assert::AreEqual(funcs[0](t) + t, sum(t), 1e-15, L"sum", LINE_INFO());
+            Assert::AreEqual(funcs[0](t) * t, prod(t), 1e-15, L"product", LINE_INFO());
+            Assert::AreEqual(funcs[0](t) + 2 * t, scaled(t), 1e-15, L"mult_add", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_fused_expression)
+            TEST_DESCRIPTION(L"expression matches the sequence of map passes")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_fused_expression)
+        {
+            std::vector < double > a(1000), b(1000), c(1000), d(1000);
+            sampled_t sa = make_sampled(a, 1), sb = make_sampled(b, 2);
+            sampled_t sc = make_sampled(c, 1), sd = make_sampled(d, 3);
+
+            /* reference: two passes */
+            map(sa, sb, mult_add_op(0.5));
+            map(sa, [] (size_t, double v) { return v * 4; });
+
+            /* fused, reads the destination */
+            expr::assign(sc, expr::apply(mult_add_op(0.5), expr::val(sc), expr::val(sb)) * 4.);
+            for (size_t i = 0; i < a.size(); ++i) Assert::AreEqual(a[i], c[i], 1e-15, L"fused", LINE_INFO());
+
+            using namespace expr;
+            assign(sd, - (val(sb) + 1.) / 2. - 3. * val(sb) + apply([] (size_t i, double v) { return v + i; }, val(sb)));
+            for (size_t i = 0; i < d.size(); ++i)
+            {
+                double expected = - (b[i] + 1) / 2 - 3 * b[i] + (b[i] + i);
+                Assert::AreEqual(expected, d[i], 1e-12, L"arithmetic", LINE_INFO());
+            }
+        }
+    };
+}
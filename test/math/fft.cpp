@@ -0,0 +1,300 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/fft.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static std::vector < complex < > > make_signal(size_t n)
+    {
+        std::vector < complex < > > data(n);
+        srand((unsigned) n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            data[i] = { random(), random() };
+        }
+        return data;
+    }
+
+    static std::vector < complex < > > dft(const std::vector < complex < > > & data, int is)
+    {
+        size_t n = data.size();
+        std::vector < complex < > > result(n);
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                double theta = is * 2 * M_PI * ((k * j) % n) / n;
+                result[k] = result[k] + data[j] * complex < > (std::cos(theta), std::sin(theta));
+            }
+            if (is > 0) result[k] = result[k] / (double) n;
+        }
+        return result;
+    }
+
+    static double max_error(const std::vector < complex < > > & a, const std::vector < complex < > > & b)
+    {
+        double e = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            e = (std::max)(e, norm(a[i] - b[i]));
+        }
+        return e;
+    }
+
+    TEST_CLASS(fft_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_plan_matches_dft)
+            TEST_DESCRIPTION(L"fft_plan matches direct DFT")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_plan_matches_dft)
+        {
+            for (size_t n = 1; n <= 512; n <<= 1)
+            {
+                auto data = make_signal(n);
+                auto expected = dft(data, -1);
+                fft_plan(n, -1).execute(data.data());
+                Assert::IsTrue(max_error(data, expected) < 1e-9 * n, L"forward", LINE_INFO());
+
+                data = make_signal(n);
+                expected = dft(data, 1);
+                fft_plan(n, 1).execute(data.data());
+                Assert::IsTrue(max_error(data, expected) < 1e-9, L"inverse", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_plan_matches_fourier)
+            TEST_DESCRIPTION(L"fft_plan matches fourier")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_plan_matches_fourier)
+        {
+            size_t n = 1 << 12;
+            auto data = make_signal(n);
+            auto expected = data;
+            fourier(expected.data(), (int) n, -1);
+            fft_plan(n, -1).execute(data.data());
+            Assert::IsTrue(max_error(data, expected) < 1e-9, L"forward", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_plan_reuse)
+            TEST_DESCRIPTION(L"fft_plan may be executed repeatedly")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_plan_reuse)
+        {
+            size_t n = 1 << 10;
+            fft_plan forward(n, -1), inverse(n, 1);
+            auto original = make_signal(n);
+            auto data = original;
+            for (size_t i = 0; i < 10; ++i)
+            {
+                forward(data.data());
+                inverse(data.data());
+            }
+            Assert::IsTrue(max_error(data, original) < 1e-12, L"round trip", LINE_INFO());
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rfft_forward)
+            TEST_DESCRIPTION(L"rfft_plan forward matches direct DFT")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rfft_forward)
+        {
+            for (size_t n = 2; n <= 512; n <<= 1)
+            {
+                std::vector < double > input(n);
+                std::vector < complex < > > widened(n);
+                for (size_t i = 0; i < n; ++i) widened[i] = input[i] = random();
+                auto expected = dft(widened, -1);
+
+                rfft_plan plan(n, -1);
+                std::vector < complex < > > spectrum(plan.spectrum_size());
+                plan.execute(input.data(), spectrum.data());
+
+                expected.resize(plan.spectrum_size());
+                Assert::IsTrue(max_error(spectrum, expected) < 1e-9 * n, L"forward", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rfft_round_trip)
+            TEST_DESCRIPTION(L"rfft_plan inverse restores sampled_t signal")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rfft_round_trip)
+        {
+            size_t n = 1 << 10;
+            sampled_t input = allocate_sampled(n, 1);
+            sampled_t output = allocate_sampled(n, 1);
+            for (size_t i = 0; i < n; ++i) input.samples[i] = random();
+
+            rfft_plan forward(n, -1), inverse(n, 1);
+            std::vector < complex < > > spectrum(forward.spectrum_size());
+            forward.execute(input, spectrum.data());
+            inverse.execute(spectrum.data(), output);
+
+            double e = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                e = (std::max)(e, std::abs(input.samples[i] - output.samples[i]));
+            }
+            free_sampled(input);
+            free_sampled(output);
+            Assert::IsTrue(e < 1e-12, L"round trip", LINE_INFO());
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_plan_any_length)
+            TEST_DESCRIPTION(L"fft_plan matches direct DFT for non-power-of-two lengths")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_plan_any_length)
+        {
+            size_t sizes[] = { 3, 5, 6, 7, 12, 15, 45, 60, 97, 100, 243, 625, 1000, 1009 };
+            for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            {
+                size_t n = sizes[s];
+
+                auto data = make_signal(n);
+                auto expected = dft(data, -1);
+                fft_plan(n, -1).execute(data.data());
+                Assert::IsTrue(max_error(data, expected) < 1e-9 * n, L"forward", LINE_INFO());
+
+                data = make_signal(n);
+                expected = dft(data, 1);
+                fft_plan(n, 1).execute(data.data());
+                Assert::IsTrue(max_error(data, expected) < 1e-9, L"inverse", LINE_INFO());
+            }
+
+            Assert::AreEqual((int) fft_plan::mixed_radix, (int) fft_plan(1000, -1).kind(), L"1000", LINE_INFO());
+            Assert::AreEqual((int) fft_plan::bluestein, (int) fft_plan(1009, -1).kind(), L"1009", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rfft_any_length)
+            TEST_DESCRIPTION(L"rfft_plan round trip for non-power-of-two lengths")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rfft_any_length)
+        {
+            size_t sizes[] = { 6, 14, 1000, 3000, 2018 };
+            for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            {
+                size_t n = sizes[s];
+                std::vector < double > input(n), output(n);
+                std::vector < complex < > > widened(n);
+                for (size_t i = 0; i < n; ++i) widened[i] = input[i] = random();
+                auto expected = dft(widened, -1);
+                expected.resize(n / 2 + 1);
+
+                rfft_plan forward(n, -1), inverse(n, 1);
+                std::vector < complex < > > spectrum(forward.spectrum_size());
+                std::vector < complex < > > scratch(forward.scratch_size());
+                forward.execute(input.data(), spectrum.data(), scratch.data());
+                Assert::IsTrue(max_error(spectrum, expected) < 1e-9 * n, L"forward", LINE_INFO());
+
+                inverse.execute(spectrum.data(), output.data(), scratch.data());
+                double e = 0;
+                for (size_t i = 0; i < n; ++i) e = (std::max)(e, std::abs(input[i] - output[i]));
+                Assert::IsTrue(e < 1e-12, L"round trip", LINE_INFO());
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_simd_matches_scalar)
+            TEST_DESCRIPTION(L"SIMD kernels stay within log2(n) ULP of the scalar kernel")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_simd_matches_scalar)
+        {
+            simd::level levels[] = { simd::sse2, simd::avx, simd::avx2 };
+            for (size_t p = 1; p <= 16; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                auto original = make_signal(n);
+                auto expected = original;
+                fft_plan(n, -1, simd::scalar).execute(expected.data());
+
+                double max = 0;
+                for (size_t i = 0; i < n; ++i) max = (std::max)(max, norm(expected[i]));
+                double budget = p * std::numeric_limits < double > :: epsilon() * max;
+
+                for (size_t l = 0; l < 3; ++l)
+                {
+                    auto data = original;
+                    fft_plan(n, -1, levels[l]).execute(data.data());
+                    Assert::IsTrue(max_error(data, expected) <= budget, L"forward", LINE_INFO());
+                }
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_batch)
+            TEST_DESCRIPTION(L"fft_batch matches per-channel plan for both layouts")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_batch)
+        {
+            util::thread_pool pool(4);
+            size_t sizes[] = { 1024, 1000 };
+            for (size_t s = 0; s < 2; ++s)
+            {
+                size_t n = sizes[s], count = 16;
+                auto data = make_signal(n * count);
+
+                auto expected = data;
+                fft_plan plan(n, -1);
+                for (size_t c = 0; c < count; ++c) plan.execute(expected.data() + c * n);
+
+                auto contiguous = data;
+                fft_batch(n, -1, count, 1, n).execute(contiguous.data(), pool);
+                Assert::IsTrue(max_error(contiguous, expected) == 0, L"contiguous", LINE_INFO());
+
+                std::vector < complex < > > interleaved(n * count);
+                for (size_t c = 0; c < count; ++c)
+                for (size_t i = 0; i < n; ++i)
+                    interleaved[i * count + c] = data[c * n + i];
+                fft_batch batch(n, -1, count, count, 1);
+                batch.execute(interleaved.data(), pool);
+                for (size_t c = 0; c < count; ++c)
+                for (size_t i = 0; i < n; ++i)
+                    Assert::IsTrue(interleaved[i * count + c] == expected[c * n + i], L"interleaved", LINE_INFO());
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_out_of_place_algorithms)
+            TEST_DESCRIPTION(L"Stockham and six-step plans match the in-place plan")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_out_of_place_algorithms)
+        {
+            fft_plan::algorithm algos[] = { fft_plan::stockham, fft_plan::six_step };
+            for (size_t p = 0; p <= 13; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                auto original = make_signal(n);
+                for (int is = -1; is <= 1; is += 2)
+                {
+                    auto expected = original;
+                    fft_plan(n, is, fft_plan::power_of_two).execute(expected.data());
+                    for (size_t a = 0; a < 2; ++a)
+                    {
+                        auto data = original;
+                        fft_plan plan(n, is, algos[a]);
+                        Assert::AreEqual((int) algos[a], (int) plan.kind(), L"kind", LINE_INFO());
+                        plan.execute(data.data());
+                        Assert::IsTrue(max_error(data, expected) < 1e-12 * (p + 1), L"result", LINE_INFO());
+                    }
+                }
+            }
+            Assert::AreEqual((int) fft_plan::stockham,
+                             (int) fft_plan(fft_plan::stockham_threshold(), -1).kind(), L"automatic", LINE_INFO());
+        }
+    };
+}
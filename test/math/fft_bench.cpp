@@ -0,0 +1,204 @@
+﻿#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+
+#include <util/common/math/fft.h>
+#include <util/common/math/convolution.h>
+#include <util/common/thread_pool.h>
+
+#include "bench.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    TEST_CLASS(fft_bench)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_plan_vs_fourier)
+            TEST_DESCRIPTION(L"fft_plan reuse vs fourier, n = 2^6..2^22")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_plan_vs_fourier)
+        {
+            Logger::WriteMessage("       n      fourier, us         plan, us   speedup\n");
+            for (size_t p = 6; p <= 22; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                std::vector < complex < > > data(n, complex < > (1, 0));
+                fft_plan plan(n, -1);
+                double t_fourier = bench([&] () { fourier(data.data(), (int) n, -1); });
+                double t_plan    = bench([&] () { plan.execute(data.data()); });
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << n
+                   << std::setw(17) << t_fourier
+                   << std::setw(17) << t_plan
+                   << std::setw(10) << t_fourier / t_plan << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rfft_vs_fft)
+            TEST_DESCRIPTION(L"rfft_plan vs widened fft_plan, n = 2^6..2^22")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rfft_vs_fft)
+        {
+            Logger::WriteMessage("       n         fft, us        rfft, us   speedup\n");
+            for (size_t p = 6; p <= 22; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                std::vector < double > input(n, 1);
+                std::vector < complex < > > data(n);
+                fft_plan plan(n, -1);
+                rfft_plan rplan(n, -1);
+                double t_fft  = bench([&] ()
+                {
+                    for (size_t i = 0; i < n; ++i) data[i] = { input[i], 0 };
+                    plan.execute(data.data());
+                });
+                double t_rfft = bench([&] () { rplan.execute(input.data(), data.data()); });
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << n
+                   << std::setw(16) << t_fft
+                   << std::setw(16) << t_rfft
+                   << std::setw(10) << t_fft / t_rfft << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_simd_vs_scalar)
+            TEST_DESCRIPTION(L"SIMD radix-4 kernels vs scalar kernel, n = 2^6..2^22")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_simd_vs_scalar)
+        {
+            Logger::WriteMessage("       n      scalar, us        sse2, us         avx, us\n");
+            for (size_t p = 6; p <= 22; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                std::vector < complex < > > data(n, complex < > (1, 0));
+                fft_plan scalar(n, -1, simd::scalar), sse2(n, -1, simd::sse2), avx(n, -1, simd::avx);
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << n
+                   << std::setw(16) << bench([&] () { scalar.execute(data.data()); })
+                   << std::setw(16) << bench([&] () { sse2.execute(data.data()); })
+                   << std::setw(16) << bench([&] () { avx.execute(data.data()); }) << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_batch_vs_serial)
+            TEST_DESCRIPTION(L"fft_batch on all cores vs serial loop, 64/256 channels")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_batch_vs_serial)
+        {
+            util::thread_pool pool;
+            std::ostringstream header;
+            header << "workers: " << pool.size() << std::endl
+                   << "channels       n      serial, us     batched, us   speedup" << std::endl;
+            Logger::WriteMessage(header.str().c_str());
+            size_t channels[] = { 64, 256 };
+            for (size_t c = 0; c < 2; ++c)
+            for (size_t p = 10; p <= 14; p += 2)
+            {
+                size_t n = (size_t) 1 << p, count = channels[c];
+                std::vector < complex < > > data(n * count, complex < > (1, 0));
+                fft_plan plan(n, -1);
+                fft_batch batch(n, -1, count, 1, n);
+                double t_serial = bench([&] ()
+                {
+                    for (size_t i = 0; i < count; ++i) plan.execute(data.data() + i * n);
+                });
+                double t_batch = bench([&] () { batch.execute(data.data(), pool); });
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << count
+                   << std::setw(8) << n
+                   << std::setw(16) << t_serial
+                   << std::setw(16) << t_batch
+                   << std::setw(10) << t_serial / t_batch << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    
+        BEGIN_TEST_METHOD_ATTRIBUTE(_large_transforms)
+            TEST_DESCRIPTION(L"Stockham and six-step vs in-place plan and fourier, n = 2^20..2^26")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_large_transforms)
+        {
+            Logger::WriteMessage("       n      fourier, us     in-place, us     stockham, us     six-step, us\n");
+            for (size_t p = 20; p <= 26; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                std::vector < complex < > > data(n, complex < > (1, 0)), scratch(n);
+                fft_plan in_place(n, -1, fft_plan::power_of_two);
+                fft_plan stockham(n, -1, fft_plan::stockham);
+                fft_plan six_step(n, -1, fft_plan::six_step);
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << n
+                   << std::setw(17) << bench([&] () { fourier(data.data(), (int) n, -1); })
+                   << std::setw(17) << bench([&] () { in_place.execute(data.data()); })
+                   << std::setw(17) << bench([&] () { stockham.execute(data.data(), scratch.data()); })
+                   << std::setw(17) << bench([&] () { six_step.execute(data.data(), scratch.data()); })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_convolution_direct_vs_fft)
+            TEST_DESCRIPTION(L"direct vs FFT convolution, cyclic n = 2^4..2^12, linear 2^16 x m")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_convolution_direct_vs_fft)
+        {
+            Logger::WriteMessage("       n       direct, us          fft, us\n");
+            for (size_t p = 4; p <= 12; ++p)
+            {
+                size_t n = (size_t) 1 << p;
+                std::vector < double > f(n, 1.), g(n, 1.), out(n);
+                sampled_t sf = { f.data(), n, 1 }, sg = { g.data(), n, 1 }, so = { out.data(), n, 1 };
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << n
+                   << std::setw(17) << bench([&] () { convolve(sf, sg, so); })
+                   << std::setw(17) << bench([&] () { _convolve_cyclic_fft(f.data(), g.data(), n, out.data()); })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+            Logger::WriteMessage("       m       direct, us          fft, us\n");
+            for (size_t m = 8; m <= 1024; m <<= 1)
+            {
+                size_t n = (size_t) 1 << 16;
+                std::vector < double > f(n, 1.), g(m, 1.), out(n + m - 1);
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << m
+                   << std::setw(17) << bench([&] () { _convolve_linear_direct(f.data(), n, g.data(), m, out.data()); })
+                   << std::setw(17) << bench([&] () { _convolve_linear_fft(f.data(), n, g.data(), m, out.data()); })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    };
+}
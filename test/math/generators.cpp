@@ -0,0 +1,161 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+
+#include <util/common/math/generators.h>
+
+#include "bench.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    TEST_CLASS(generators_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_sin_matches_continuous)
+            TEST_DESCRIPTION(L"sample_sin matches sample(sin(...)) on all instruction sets")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_sin_matches_continuous)
+        {
+            std::vector < double > expected(10003), actual(10003), simd(10003);
+            sampled_t se = { expected.data(), expected.size(), 1e-3 };
+            sampled_t sa = { actual.data(), actual.size(), 1e-3 };
+            sampled_t ss = { simd.data(), simd.size(), 1e-3 };
+
+            continuous_t f = sin(2.5, 13.7);
+            double p1 = sample(f, se);
+            double p2 = sample_sin(sa, 2.5, 13.7, simd::scalar);
+            double p3 = sample_sin(ss, 2.5, 13.7);
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                Assert::AreEqual(expected[i], actual[i], 1e-12, L"sin", LINE_INFO());
+                Assert::AreEqual(actual[i], simd[i], 1e-14, L"simd", LINE_INFO());
+            }
+            Assert::AreEqual(p1, p2, 1e-8, L"power", LINE_INFO());
+            Assert::AreEqual(p2, p3, 1e-9, L"simd power", LINE_INFO());
+
+            sinT_t params = { 0.7, 0.031, 0.4 };
+            f = sin(params);
+            sample(f, se);
+            sample_sin(sa, params, simd::scalar);
+            sample_sin(ss, params);
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                Assert::AreEqual(expected[i], actual[i], 1e-12, L"sinT", LINE_INFO());
+                Assert::AreEqual(actual[i], simd[i], 1e-14, L"sinT simd", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_gaussian_matches_continuous)
+            TEST_DESCRIPTION(L"sample_gaussian matches sample(gaussian(...)), incl. the underflow")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_gaussian_matches_continuous)
+        {
+            std::vector < double > expected(4001), actual(4001), simd(4001);
+            sampled_t se = { expected.data(), expected.size(), 1e-2 };
+            sampled_t sa = { actual.data(), actual.size(), 1e-2 };
+            sampled_t ss = { simd.data(), simd.size(), 1e-2 };
+
+            gaussian_t params = { 3, 0.5, 15 };
+            continuous_t f = gaussian(params);
+            sample(f, se);
+            sample_gaussian(sa, params, simd::scalar);
+            sample_gaussian(ss, params);
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                Assert::AreEqual(expected[i], actual[i], 1e-15 + 1e-14 * expected[i], L"gaussian", LINE_INFO());
+                Assert::AreEqual(actual[i], simd[i], 1e-14, L"simd", LINE_INFO());
+            }
+            Assert::AreEqual(0., actual[0], 0., L"underflow", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rng_streams)
+            TEST_DESCRIPTION(L"xoshiro256 is reproducible and its streams differ")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rng_streams)
+        {
+            xoshiro256 a(42), b(42), c = xoshiro256::stream(42, 1);
+            bool differ = false;
+            for (size_t i = 0; i < 100; ++i)
+            {
+                uint64_t x = a.next();
+                Assert::IsTrue(x == b.next(), L"reproducible", LINE_INFO());
+                differ = differ || (x != c.next());
+            }
+            Assert::IsTrue(differ, L"streams", LINE_INFO());
+
+            double u = 0;
+            for (size_t i = 0; i < 100000; ++i)
+            {
+                double v = a.uniform();
+                Assert::IsTrue((v >= 0) && (v < 1), L"range", LINE_INFO());
+                u += v;
+            }
+            Assert::AreEqual(0.5, u / 100000, 0.01, L"mean", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_noise_distribution)
+            TEST_DESCRIPTION(L"sample_noise has the mean and variance of noise(...)")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_noise_distribution)
+        {
+            std::vector < double > data(100000);
+            sampled_t s = { data.data(), data.size(), 1 };
+            size_t trusts[] = { 1, 5, 20 };
+            for (size_t trust : trusts)
+            {
+                xoshiro256 rng(7);
+                double power = sample_noise(s, rng, -1, 3, trust);
+                double mean = 0, var = 0;
+                for (size_t i = 0; i < data.size(); ++i)
+                {
+                    Assert::IsTrue((data[i] >= -1) && (data[i] <= 3), L"range", LINE_INFO());
+                    mean += data[i];
+                }
+                mean /= data.size();
+                for (size_t i = 0; i < data.size(); ++i) var += (data[i] - mean) * (data[i] - mean);
+                var /= data.size();
+                Assert::AreEqual(1., mean, 0.02, L"mean", LINE_INFO());
+                Assert::AreEqual(16. / 12 / trust, var, 0.05 / trust, L"variance", LINE_INFO());
+                Assert::AreEqual(data.size() * (var + mean * mean), power, 1e-6 * power, L"power", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_generators_vs_sample)
+            TEST_DESCRIPTION(L"block generators vs sample(continuous_t), n = 2^20")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_generators_vs_sample)
+        {
+            size_t n = (size_t) 1 << 20;
+            std::vector < double > data(n);
+            sampled_t s = { data.data(), n, 1e-4 };
+            gaussian_t g = { 1, 10, 50 };
+            continuous_t fs = sin(1, 13.7), fg = gaussian(g), fn = noise();
+            xoshiro256 rng(1);
+            Logger::WriteMessage("  signal       sample, us        block, us\n");
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(2)
+               << "     sin" << std::setw(17) << bench([&] () { sample(fs, s); })
+               << std::setw(17) << bench([&] () { sample_sin(s, 1, 13.7); }) << std::endl
+               << "gaussian" << std::setw(17) << bench([&] () { sample(fg, s); })
+               << std::setw(17) << bench([&] () { sample_gaussian(s, g); }) << std::endl
+               << "   noise" << std::setw(17) << bench([&] () { sample(fn, s); })
+               << std::setw(17) << bench([&] () { sample_noise(s, rng); }) << std::endl;
+            Logger::WriteMessage(os.str().c_str());
+        }
+    };
+}
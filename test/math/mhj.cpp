@@ -0,0 +1,108 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#include <util/common/math/mhj.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    /* a coupled quadratic with the minimum at x[i] = 0.1 i */
+    static double bowl(const double * x, size_t n)
+    {
+        double s = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            double d = x[i] - 0.1 * i;
+            s += (1 + i) * d * d;
+            if (i > 0) s += 0.5 * d * (x[i - 1] - 0.1 * (i - 1));
+        }
+        return s;
+    }
+
+    TEST_CLASS(mhj_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_parallel_exploration)
+            TEST_DESCRIPTION(L"parallel mhj converges as the sequential one and does not depend on the worker count")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_parallel_exploration)
+        {
+            const size_t n = 6;
+            double xs[n], x1[n], x4[n];
+
+            srand(1);
+            mhj_method::mhj([n] (double * x) { return bowl(x, n); }, { xs, n });
+
+            util::thread_pool one(1), four(4);
+            std::atomic < size_t > calls;
+            calls = 0;
+            auto f = [n, &calls] (const double * x, size_t) { ++calls; return bowl(x, n); };
+            srand(1);
+            mhj_method::mhj(f, { x1, n }, one);
+            size_t calls1 = calls;
+            calls = 0;
+            srand(1);
+            mhj_method::mhj(f, { x4, n }, four);
+
+            Assert::IsTrue(calls1 == calls, L"same evaluations", LINE_INFO());
+            for (size_t i = 0; i < n; ++i)
+            {
+                Assert::AreEqual(0.1 * i, xs[i], 1e-3, L"sequential", LINE_INFO());
+                Assert::AreEqual(0.1 * i, x4[i], 1e-3, L"parallel", LINE_INFO());
+                Assert::IsTrue(x1[i] == x4[i], L"deterministic", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_mhj_sequential_vs_parallel)
+            TEST_DESCRIPTION(L"5 mhj steps with a 1 ms objective: sequential vs parallel exploration")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_mhj_sequential_vs_parallel)
+        {
+            using clock = std::chrono::high_resolution_clock;
+            util::thread_pool pool(16);
+            Logger::WriteMessage("       n  sequential, s  parallel, s\n");
+            for (size_t n = 4; n <= 16; n <<= 1)
+            {
+                std::vector < double > x(n);
+                auto objective = [n] (const double * p)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    double s = 0;
+                    for (size_t i = 0; i < n; ++i) s += (p[i] - 0.1 * i) * (p[i] - 0.1 * i);
+                    return s;
+                };
+                mhj_method sequential([&] (double * p) { return objective(p); }, { x.data(), n }, 1e-6, 1e-3);
+                auto start = clock::now();
+                for (int k = 0; k < 5 && !sequential; ++k) ++sequential;
+                double ts = std::chrono::duration < double > (clock::now() - start).count();
+
+                mhj_method parallel([&] (const double * p, size_t) { return objective(p); },
+                                    { x.data(), n }, pool, 1e-6, 1e-3);
+                start = clock::now();
+                for (int k = 0; k < 5 && !parallel; ++k) ++parallel;
+                double tp = std::chrono::duration < double > (clock::now() - start).count();
+
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(3)
+                   << std::setw(8) << n << std::setw(15) << ts << std::setw(13) << tp << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    };
+}
@@ -0,0 +1,158 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+#include <util/common/math/polyphase.h>
+#include <util/common/math/convolution.h>
+
+#include "bench.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    /* upsample by zero-stuffing, filter, keep every `down`-th sample */
+    static std::vector < double > naive_resample(const std::vector < double > & x,
+                                                 const std::vector < double > & h,
+                                                 size_t up, size_t down)
+    {
+        std::vector < double > y;
+        for (size_t t = 0; t < x.size() * up; t += down)
+        {
+            double s = 0;
+            for (size_t k = 0; k < h.size() && k <= t; ++k)
+            {
+                if ((t - k) % up == 0) s += h[k] * x[(t - k) / up];
+            }
+            y.push_back(s);
+        }
+        return y;
+    }
+
+    TEST_CLASS(polyphase_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_matches_naive)
+            TEST_DESCRIPTION(L"polyphase_filter matches upsample-filter-downsample on all instruction sets")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_matches_naive)
+        {
+            size_t ratios[][2] = { { 1, 1 }, { 1, 3 }, { 4, 1 }, { 3, 2 }, { 2, 5 } };
+            simd::level isas[] = { simd::scalar, simd::sse2, simd::avx };
+            srand(5);
+            std::vector < double > x(501), h(37);
+            for (size_t i = 0; i < x.size(); ++i) x[i] = random();
+            for (size_t i = 0; i < h.size(); ++i) h[i] = random();
+            for (auto & r : ratios)
+            for (simd::level isa : isas)
+            {
+                auto expected = naive_resample(x, h, r[0], r[1]);
+                polyphase_filter f(h.data(), h.size(), r[0], r[1], isa);
+                std::vector < double > y(f.max_output(x.size()));
+                size_t n = f.process(x.data(), x.size(), y.data());
+                Assert::AreEqual(expected.size(), n, L"count", LINE_INFO());
+                for (size_t i = 0; i < n; ++i)
+                {
+                    Assert::AreEqual(expected[i], y[i], 1e-12, L"sample", LINE_INFO());
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_streaming)
+            TEST_DESCRIPTION(L"blocks of any size give the same output as the whole signal")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_streaming)
+        {
+            srand(6);
+            std::vector < double > x(1000);
+            for (size_t i = 0; i < x.size(); ++i) x[i] = random();
+            auto h = polyphase_filter::lowpass(3, 7);
+
+            polyphase_filter whole(h.data(), h.size(), 3, 7), blocks(h.data(), h.size(), 3, 7);
+            std::vector < double > expected(whole.max_output(x.size())), actual;
+            expected.resize(whole.process(x.data(), x.size(), expected.data()));
+
+            size_t sizes[] = { 1, 2, 5, 64, 13, 100 };
+            for (size_t pos = 0, b = 0; pos < x.size(); ++b)
+            {
+                size_t c = (std::min)(sizes[b % 6], x.size() - pos);
+                std::vector < double > y(blocks.max_output(c));
+                y.resize(blocks.process(x.data() + pos, c, y.data()));
+                actual.insert(actual.end(), y.begin(), y.end());
+                pos += c;
+            }
+            Assert::AreEqual(expected.size(), actual.size(), L"count", LINE_INFO());
+            for (size_t i = 0; i < actual.size(); ++i)
+            {
+                Assert::AreEqual(expected[i], actual[i], 1e-14, L"sample", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_resample_sine)
+            TEST_DESCRIPTION(L"resample keeps an in-band sine and suppresses an out-of-band one")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_resample_sine)
+        {
+            /* 2/5 rate change: 0.03 cycles/sample passes, 0.45 is above the new Nyquist */
+            std::vector < double > x(5000), y(2000);
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                x[i] = std::sin(2 * M_PI * 0.03 * i) + std::sin(2 * M_PI * 0.45 * i);
+            }
+            sampled_t sx = { x.data(), x.size(), 1 }, sy = { y.data(), y.size(), 0 };
+            size_t n = resample(sx, sy, 2, 5);
+            Assert::AreEqual((size_t) 2000, n, L"count", LINE_INFO());
+            Assert::AreEqual(2.5, sy.period, 1e-15, L"period", LINE_INFO());
+
+            /* the filter delay is 8 * 5 upsampled samples */
+            double err = 0;
+            for (size_t i = 100; i < n - 100; ++i)
+            {
+                double expected = std::sin(2 * M_PI * 0.03 * (5. * i - 40) / 2);
+                err = (std::max)(err, std::abs(y[i] - expected));
+            }
+            Assert::IsTrue(err < 1e-3, L"in-band error", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_polyphase_vs_convolve)
+            TEST_DESCRIPTION(L"polyphase decimation vs linear convolution and picking, n = 2^20")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_polyphase_vs_convolve)
+        {
+            size_t n = (size_t) 1 << 20;
+            Logger::WriteMessage("  factor   convolve, us  polyphase, us\n");
+            for (size_t factor = 2; factor <= 16; factor <<= 1)
+            {
+                std::vector < double > h = polyphase_filter::lowpass(1, factor);
+                std::vector < double > x(n, 1.), full(n + h.size() - 1), y(n / factor + 1);
+                sampled_t sx = { x.data(), n, 1 }, sh = { h.data(), h.size(), 1 };
+                sampled_t sf = { full.data(), full.size(), 1 };
+                polyphase_filter f(h.data(), h.size(), 1, factor);
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << factor
+                   << std::setw(15) << bench([&] ()
+                      {
+                          convolve(sx, sh, sf, linear_convolution);
+                          for (size_t i = 0; i < n / factor; ++i) y[i] = full[i * factor];
+                      })
+                   << std::setw(15) << bench([&] () { f.reset(); f.process(x.data(), n, y.data()); })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    };
+}
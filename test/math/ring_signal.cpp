@@ -0,0 +1,82 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/ring_signal.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    TEST_CLASS(ring_signal_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_window_and_stats)
+            TEST_DESCRIPTION(L"running power and autocorrelation match the ones of the window")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_window_and_stats)
+        {
+            const size_t capacity = 100, lags = 10;
+            ring_signal ring(capacity, 0.5, lags);
+            std::vector < double > stream;
+            srand(1);
+
+            size_t blocks[] = { 3, 40, 1, 97, 150, 7, 64 };
+            for (size_t b = 0; b < 21; ++b)
+            {
+                std::vector < double > block(blocks[b % 7]);
+                for (size_t i = 0; i < block.size(); ++i) block[i] = random();
+                sampled_t sb = { block.data(), block.size(), 0.5 };
+                ring.append(sb);
+                stream.insert(stream.end(), block.begin(), block.end());
+
+                size_t n = (std::min)(stream.size(), capacity);
+                Assert::AreEqual(n, ring.size(), L"size", LINE_INFO());
+
+                sampled_t window = ring.view();
+                double power = 0;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    double x = stream[stream.size() - n + i];
+                    Assert::AreEqual(x, window.samples[i], 0., L"view", LINE_INFO());
+                    Assert::AreEqual(x, ring[i], 0., L"index", LINE_INFO());
+                    power += x * x;
+                }
+                Assert::AreEqual(power, ring.power(), 1e-10, L"power", LINE_INFO());
+
+                if (n <= lags) continue;
+                std::vector < double > expected(lags), actual(lags);
+                sampled_t se = { expected.data(), lags, 0.5 }, sa = { actual.data(), lags, 0.5 };
+                autocorrelation(window, se);
+                ring.autocorrelation(sa);
+                for (size_t k = 0; k < lags; ++k)
+                {
+                    Assert::AreEqual(expected[k], actual[k], 1e-12, L"autocorrelation", LINE_INFO());
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_clear)
+            TEST_DESCRIPTION(L"clear empties the window and the statistics")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_clear)
+        {
+            ring_signal ring(8, 1, 2);
+            double block[] = { 1, 2, 3 };
+            ring.append(block, 3);
+            ring.clear();
+            Assert::AreEqual((size_t) 0, ring.size(), L"size", LINE_INFO());
+            Assert::AreEqual(0., ring.power(), 0., L"power", LINE_INFO());
+            ring.append(block, 2);
+            Assert::AreEqual(5., ring.power(), 0., L"power", LINE_INFO());
+            Assert::AreEqual(2., ring.autocorrelation_sum(1), 0., L"lag 1", LINE_INFO());
+        }
+    };
+}
@@ -0,0 +1,263 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+#include <util/common/math/roots.h>
+
+#include "bench.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    /* coefficients (decreasing powers) of prod (x - r_i) */
+    static std::vector < double > from_roots(const std::vector < complex < > > & r)
+    {
+        std::vector < complex < > > c(1, complex < > { 1, 0 });
+        for (size_t i = 0; i < r.size(); ++i)
+        {
+            c.push_back({ 0, 0 });
+            for (size_t k = c.size() - 1; k > 0; --k) c[k] = c[k] - r[i] * c[k - 1];
+        }
+        std::vector < double > o(c.size());
+        for (size_t k = 0; k < c.size(); ++k) o[k] = c[k].re;
+        return o;
+    }
+
+    /* every root of `r` has a match in (zr, zi) */
+    static bool same_roots(const std::vector < complex < > > & r, const double * zr, const double * zi, double tol)
+    {
+        for (size_t i = 0; i < r.size(); ++i)
+        {
+            bool found = false;
+            for (size_t j = 0; j < r.size(); ++j)
+            {
+                found = found || (norm(r[i] - complex < > { zr[j], zi[j] }) < tol);
+            }
+            if (!found) return false;
+        }
+        return true;
+    }
+
+    TEST_CLASS(roots_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rpoly_batch)
+            TEST_DESCRIPTION(L"rpoly_batch matches rpoly serially and on a thread_pool, reports the status")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rpoly_batch)
+        {
+            int degree = 7;
+            size_t count = 1000;
+            srand(17);
+            std::vector < double > c(count * (degree + 1));
+            for (auto & x : c) x = (double) rand() / RAND_MAX - 0.5;
+            c[5 * (degree + 1)] = 0;                 /* zero leading coefficient */
+            c[6 * (degree + 1) + degree] = 0;        /* a root at the origin */
+
+            std::vector < double > er(count * degree), ei(count * degree);
+            std::vector < int > en(count);
+            size_t expected = 0;
+            for (size_t q = 0; q < count; ++q)
+            {
+                en[q] = rpoly(&c[q * (degree + 1)], degree, &er[q * degree], &ei[q * degree]);
+                if (en[q] == degree) ++expected;
+            }
+
+            rpoly_batch batch;
+            util::thread_pool pool(4);
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                std::vector < double > zr(count * degree), zi(count * degree);
+                std::vector < int > status(count);
+                size_t solved = (pass == 0)
+                    ? batch.solve(c.data(), count, degree, zr.data(), zi.data(), status.data())
+                    : batch.solve(c.data(), count, degree, zr.data(), zi.data(), status.data(), pool);
+                Assert::IsTrue(solved == expected, L"solved", LINE_INFO());
+                Assert::AreEqual(-1, status[5], L"invalid", LINE_INFO());
+                Assert::AreEqual(degree, status[6], L"origin", LINE_INFO());
+                for (size_t q = 0; q < count; ++q)
+                {
+                    Assert::AreEqual(en[q], status[q], L"status", LINE_INFO());
+                    for (int i = 0; i < degree; ++i)
+                    {
+                        size_t o = q * degree + i;
+                        if (i < en[q])
+                        {
+                            Assert::IsTrue((zr[o] == er[o]) && (zi[o] == ei[o]), L"roots", LINE_INFO());
+                        }
+                        else
+                        {
+                            Assert::IsTrue((zr[o] != zr[o]) && (zi[o] != zi[o]), L"NaN", LINE_INFO());
+                        }
+                    }
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_root_tracker)
+            TEST_DESCRIPTION(L"root_tracker follows the roots of a sweep continuously and falls back at collisions")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_root_tracker)
+        {
+            root_tracker tracker;
+            int steps = 200, branch = -1;
+            double zr[6], zi[6];
+            for (int s = 0; s <= steps; ++s)
+            {
+                double t = (double) s / steps;
+                std::vector < complex < > > r = {
+                    { 1 + 0.5 * t, 0 }, { -2 + 0.1 * t, 0 },
+                    { 0.3, 1 + 0.2 * t }, { 0.3, - 1 - 0.2 * t },
+                    { -0.7 - 0.3 * t, 0 }, { 2.5 * t - 3, 0 }
+                };
+                auto op = from_roots(r);
+                Assert::AreEqual(6, tracker.solve(op.data(), 6, zr, zi), L"found", LINE_INFO());
+                Assert::IsTrue(same_roots(r, zr, zi, 1e-9), L"roots", LINE_INFO());
+
+                /* the branch of 1 + 0.5 t keeps its index */
+                if (branch < 0)
+                    for (int i = 0; i < 6; ++i)
+                        if (norm(r[0] - complex < > { zr[i], zi[i] }) < 1e-9) branch = i;
+                Assert::AreEqual(r[0].re, zr[branch], 1e-9, L"continuous", LINE_INFO());
+            }
+            Assert::IsTrue(tracker.fallbacks() >= 1, L"the first step", LINE_INFO());
+            Assert::IsTrue(tracker.tracked() >= (size_t) steps - 5, L"tracked", LINE_INFO());
+
+            /* two real roots meet at t = 0.5 (a double root) and pass each other */
+            root_tracker crossing;
+            for (int s = 0; s <= 20; ++s)
+            {
+                double t = s / 20.;
+                std::vector < complex < > > r = { { t, 0 }, { 1 - t, 0 }, { -1, 0 } };
+                auto op = from_roots(r);
+                Assert::AreEqual(3, crossing.solve(op.data(), 3, zr, zi), L"found", LINE_INFO());
+                Assert::IsTrue(same_roots(r, zr, zi, 1e-6), L"roots", LINE_INFO());
+            }
+            Assert::IsTrue(crossing.tracked() + crossing.fallbacks() == 21, L"steps", LINE_INFO());
+
+            /* a jump the iteration limit cannot absorb */
+            root_tracker jumpy(2);
+            std::vector < complex < > > a = { { 1.72, 0 }, { 7.36, 0 }, { 2.11, 0 } }, b = { { -5.71, 0 }, { 3.68, 4.43 }, { 3.68, -4.43 } };
+            auto pa = from_roots(a), pb = from_roots(b);
+            Assert::AreEqual(3, jumpy.solve(pa.data(), 3, zr, zi), L"found", LINE_INFO());
+            std::vector < complex < > > previous(3);
+            for (int i = 0; i < 3; ++i) previous[i] = { zr[i], zi[i] };
+            Assert::AreEqual(3, jumpy.solve(pb.data(), 3, zr, zi), L"found", LINE_INFO());
+            Assert::IsTrue(same_roots(b, zr, zi, 1e-9), L"roots", LINE_INFO());
+            Assert::IsTrue(jumpy.fallbacks() == 2, L"fallback", LINE_INFO());
+
+            /* the fallback roots continue the previous step's
+               roots (greedy nearest), not the failed iterates */
+            std::vector < char > used(3, 0);
+            for (int i = 0; i < 3; ++i)
+            {
+                int best = -1;
+                for (int j = 0; j < 3; ++j)
+                {
+                    if (used[j]) continue;
+                    if ((best < 0) || (sqnorm(b[j] - previous[i]) < sqnorm(b[best] - previous[i]))) best = j;
+                }
+                used[best] = 1;
+                Assert::AreEqual(b[best].re, zr[i], 1e-9, L"continuity re", LINE_INFO());
+                Assert::AreEqual(b[best].im, zi[i], 1e-9, L"continuity im", LINE_INFO());
+            }
+
+            double zero[] = { 0, 1, 1 };
+            Assert::AreEqual(-1, crossing.solve(zero, 2, zr, zi), L"zero leading coefficient", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rpoly_batch_vs_calls)
+            TEST_DESCRIPTION(L"10^5 polynomials: rpoly calls vs rpoly_batch serially and on a thread_pool")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rpoly_batch_vs_calls)
+        {
+            util::thread_pool pool;
+            std::ostringstream head;
+            head << "  workers: " << pool.size() << std::endl
+                 << "  degree   rpoly, us  batch, us  pool, us" << std::endl;
+            Logger::WriteMessage(head.str().c_str());
+            size_t count = 100000;
+            for (int degree = 3; degree <= 12; degree += 3)
+            {
+                std::vector < double > c(count * (degree + 1)), zr(count * degree), zi(count * degree);
+                std::vector < int > status(count);
+                for (auto & x : c) x = random() - 0.5;
+                rpoly_batch batch;
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(0)
+                   << std::setw(8) << degree
+                   << std::setw(12) << bench([&] ()
+                      {
+                          for (size_t q = 0; q < count; ++q)
+                              rpoly(&c[q * (degree + 1)], degree, &zr[q * degree], &zi[q * degree]);
+                      })
+                   << std::setw(11) << bench([&] ()
+                      {
+                          batch.solve(c.data(), count, degree, zr.data(), zi.data(), status.data());
+                      })
+                   << std::setw(10) << bench([&] ()
+                      {
+                          batch.solve(c.data(), count, degree, zr.data(), zi.data(), status.data(), pool);
+                      })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_root_tracker_vs_rpoly)
+            TEST_DESCRIPTION(L"10^4-step parameter sweep: rpoly from scratch vs root_tracker")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_root_tracker_vs_rpoly)
+        {
+            Logger::WriteMessage("  degree   rpoly, us  tracker, us  fallbacks\n");
+            int steps = 10000;
+            for (int degree = 4; degree <= 12; degree += 4)
+            {
+                /* p_t = p_0 + t q */
+                std::vector < double > p0(degree + 1), q(degree + 1), op(degree + 1), zr(degree), zi(degree);
+                for (int i = 0; i <= degree; ++i) { p0[i] = random() - 0.5; q[i] = random() - 0.5; }
+                p0[0] = 1; q[0] = 0;
+                size_t fallbacks = 0;
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(0)
+                   << std::setw(8) << degree
+                   << std::setw(12) << bench([&] ()
+                      {
+                          for (int s = 0; s < steps; ++s)
+                          {
+                              for (int i = 0; i <= degree; ++i) op[i] = p0[i] + q[i] * s / steps;
+                              rpoly(op.data(), degree, zr.data(), zi.data());
+                          }
+                      })
+                   << std::setw(13) << bench([&] ()
+                      {
+                          root_tracker tracker;
+                          for (int s = 0; s < steps; ++s)
+                          {
+                              for (int i = 0; i <= degree; ++i) op[i] = p0[i] + q[i] * s / steps;
+                              tracker.solve(op.data(), degree, zr.data(), zi.data());
+                          }
+                          fallbacks = tracker.fallbacks();
+                      })
+                   << std::setw(11) << fallbacks
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    };
+}
@@ -0,0 +1,122 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+
+#include <util/common/math/rpoly.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    /* `count` random polynomials of `degree`, leading coefficient 1 */
+    static std::vector < double > random_polynomials(int count, int degree, unsigned seed)
+    {
+        srand(seed);
+        std::vector < double > c(count * (degree + 1));
+        for (int q = 0; q < count; ++q)
+        {
+            c[q * (degree + 1)] = 1;
+            for (int i = 1; i <= degree; ++i) c[q * (degree + 1) + i] = (double) rand() / RAND_MAX - 0.5;
+        }
+        return c;
+    }
+
+    TEST_CLASS(rpoly_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_known_roots)
+            TEST_DESCRIPTION(L"rpoly finds the roots of (x - 1)(x + 2)(x^2 + 2x + 5) x")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_known_roots)
+        {
+            /* x^5 + 3 x^4 + 5 x^3 + x^2 - 10 x */
+            double op[] = { 1, 3, 5, 1, -10, 0 }, zr[5], zi[5];
+            Assert::AreEqual(5, rpoly(op, 5, zr, zi), L"roots", LINE_INFO());
+            double er[] = { 0, 1, -2, -1, -1 }, ei[] = { 0, 0, 0, 2, -2 };
+            for (int j = 0; j < 5; ++j)
+            {
+                bool found = false;
+                for (int i = 0; i < 5; ++i)
+                {
+                    found = found || ((std::abs(zr[i] - er[j]) < 1e-10) && (std::abs(zi[i] - ei[j]) < 1e-10));
+                }
+                Assert::IsTrue(found, L"root", LINE_INFO());
+            }
+
+            double zero[] = { 0, 1 };
+            Assert::AreEqual(-1, rpoly(zero, 1, zr, zi), L"zero leading coefficient", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_context_reentrant)
+            TEST_DESCRIPTION(L"rpoly_context reproduces rpoly when reused and when run from several threads")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_context_reentrant)
+        {
+            int count = 200, degree = 9;
+            auto c = random_polynomials(count, degree, 3);
+            std::vector < double > er(count * degree), ei(count * degree);
+            std::vector < int > en(count);
+            for (int q = 0; q < count; ++q)
+            {
+                en[q] = rpoly(&c[q * (degree + 1)], degree, &er[q * degree], &ei[q * degree]);
+            }
+
+            /* one context, decreasing and increasing degrees in between */
+            rpoly_context context;
+            double zr[12], zi[12], small[] = { 1, -3, 2 }, large[] = { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1 };
+            for (int q = 0; q < count; ++q)
+            {
+                context.solve((q & 1) ? small : large, (q & 1) ? 2 : 11, zr, zi);
+                Assert::AreEqual(en[q], context.solve(&c[q * (degree + 1)], degree, zr, zi), L"count", LINE_INFO());
+                Assert::IsTrue(context.iterations() > 0, L"iterations", LINE_INFO());
+                for (int i = 0; i < en[q]; ++i)
+                {
+                    Assert::IsTrue((zr[i] == er[q * degree + i]) && (zi[i] == ei[q * degree + i]), L"same roots", LINE_INFO());
+                }
+            }
+
+            /* early returns do not report the previous count */
+            double origin[] = { 1, 0, 0, 0 }, zero_leading[] = { 0, 1, 1 };
+            context.solve(&c[0], degree, zr, zi);
+            Assert::AreEqual(3, context.solve(origin, 3, zr, zi), L"roots at the origin", LINE_INFO());
+            Assert::AreEqual(0, context.iterations(), L"origin iterations", LINE_INFO());
+            context.solve(&c[0], degree, zr, zi);
+            Assert::AreEqual(-1, context.solve(zero_leading, 2, zr, zi), L"zero leading coefficient", LINE_INFO());
+            Assert::AreEqual(0, context.iterations(), L"zero leading iterations", LINE_INFO());
+
+            /* concurrent solves on separate contexts */
+            int threads = 4;
+            std::vector < double > tr(threads * count * degree), ti(threads * count * degree);
+            std::vector < std::thread > pool;
+            for (int w = 0; w < threads; ++w)
+            {
+                pool.emplace_back([&, w] ()
+                {
+                    rpoly_context local;
+                    for (int q = 0; q < count; ++q)
+                    {
+                        size_t o = (size_t) (w * count + q) * degree;
+                        local.solve(&c[q * (degree + 1)], degree, &tr[o], &ti[o]);
+                    }
+                });
+            }
+            for (int w = 0; w < threads; ++w) pool[w].join();
+            for (int w = 0; w < threads; ++w)
+            for (int q = 0; q < count; ++q)
+            for (int i = 0; i < en[q]; ++i)
+            {
+                size_t o = (size_t) (w * count + q) * degree;
+                Assert::IsTrue((tr[o + i] == er[q * degree + i]) && (ti[o + i] == ei[q * degree + i]), L"thread", LINE_INFO());
+            }
+        }
+    };
+}
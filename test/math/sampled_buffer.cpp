@@ -0,0 +1,106 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+#include <util/common/math/sampled_buffer.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    TEST_CLASS(sampled_buffer_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_aligned_view)
+            TEST_DESCRIPTION(L"sampled_buffer is 64-byte aligned and usable as sampled_t")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_aligned_view)
+        {
+            sample_pool pool;
+            size_t sizes[] = { 1, 63, 64, 65, 1000, 4097 };
+            for (size_t n : sizes)
+            {
+                sampled_buffer f(n, 0.5, pool), g(n, 0.5, pool), h(n, 0.5, pool);
+                Assert::AreEqual((uintptr_t) 0, (uintptr_t) f.samples() % sample_pool::alignment, L"alignment", LINE_INFO());
+                Assert::IsTrue(f.capacity() >= n, L"capacity", LINE_INFO());
+                for (size_t i = 0; i < n; ++i) { f[i] = 1; g[i] = (i == 0) ? 1 : 0; }
+
+                double power = convolve(f, g, h);
+                Assert::AreEqual((double) n, power, 1e-9, L"power", LINE_INFO());
+                Assert::AreEqual(n, h.view().count, L"count", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_steady_state)
+            TEST_DESCRIPTION(L"per-frame allocations hit the heap during the first frame only")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_steady_state)
+        {
+            sample_pool pool;
+            size_t blocks = 0;
+            for (size_t frame = 0; frame < 100; ++frame)
+            {
+                sampled_buffer a(1000, 1, pool), b(1000, 1, pool), c(300, 1, pool);
+                sampled_buffer d(std::move(a));
+                a = sampled_buffer(20, 1, pool);
+                if (frame == 0) blocks = pool.heap_block_count();
+            }
+            Assert::AreEqual((size_t) 4, blocks, L"first frame", LINE_INFO());
+            Assert::AreEqual(blocks, pool.heap_block_count(), L"steady state", LINE_INFO());
+            pool.trim();
+            Assert::AreEqual((size_t) 0, pool.heap_block_count(), L"trim", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_resize)
+            TEST_DESCRIPTION(L"resize preserves samples and reuses the capacity")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_resize)
+        {
+            sample_pool pool;
+            sampled_buffer f(10, 1, pool);
+            for (size_t i = 0; i < 10; ++i) f[i] = (double) i;
+            double * p = f.samples();
+            f.resize(f.capacity());
+            Assert::IsTrue(p == f.samples(), L"in place", LINE_INFO());
+            f.resize(1000);
+            Assert::IsTrue(f.capacity() >= 1000, L"grown", LINE_INFO());
+            for (size_t i = 0; i < 10; ++i) Assert::AreEqual((double) i, f[i], 0., L"preserved", LINE_INFO());
+
+            sampled_buffer empty;
+            empty.resize(5);
+            Assert::AreEqual((size_t) 5, empty.count(), L"empty resize", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_concurrent)
+            TEST_DESCRIPTION(L"the pool may be shared between threads")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_concurrent)
+        {
+            sample_pool pool;
+            std::vector < std::thread > threads;
+            for (size_t t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&pool, t] ()
+                {
+                    for (size_t i = 0; i < 1000; ++i)
+                    {
+                        sampled_buffer f(64 << (i % 4), 1, pool);
+                        f[0] = (double) t;
+                    }
+                });
+            }
+            for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+            Assert::IsTrue(pool.heap_block_count() <= 16, L"blocks", LINE_INFO());
+        }
+    };
+}
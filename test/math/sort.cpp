@@ -0,0 +1,136 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/sort.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    /* keys with many duplicates, the original positions
+       and a derived value in the two other arrays */
+    static void make_arrays(size_t n, std::vector < double > (&data)[3])
+    {
+        srand((unsigned) n);
+        for (size_t k = 0; k < 3; ++k) data[k].resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            data[0][i] = (double) (rand() % 100);
+            data[1][i] = (double) i;
+            data[2][i] = data[0][i] * 2 + 1;
+        }
+    }
+
+    static void check_sorted(std::vector < double > (&data)[3], int order, bool stable)
+    {
+        for (size_t i = 0; i < data[0].size(); ++i)
+        {
+            Assert::AreEqual(data[0][i] * 2 + 1, data[2][i], 0., L"rows kept together", LINE_INFO());
+            if (i == 0) continue;
+            Assert::IsTrue(order * (data[0][i] - data[0][i - 1]) >= 0, L"order", LINE_INFO());
+            if (stable && (data[0][i] == data[0][i - 1]))
+            {
+                Assert::IsTrue(data[1][i] > data[1][i - 1], L"stable", LINE_INFO());
+            }
+        }
+    }
+
+    TEST_CLASS(sort_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_serial)
+            TEST_DESCRIPTION(L"sort_all reorders all the arrays by the keys")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_serial)
+        {
+            size_t sizes[] = { 0, 1, 2, 17, 5000 };
+            for (size_t n : sizes)
+            for (int order = -1; order <= 1; order += 2)
+            for (int stable = 0; stable < 2; ++stable)
+            {
+                std::vector < double > data[3];
+                make_arrays(n, data);
+                double * arrays[] = { data[0].data(), data[1].data(), data[2].data() };
+                sort_all(arrays, 3, n, order, stable != 0);
+                check_sorted(data, order, stable != 0);
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_order_zero_and_nan)
+            TEST_DESCRIPTION(L"order 0 keeps the arrays, NaN keys go last in both orders")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_order_zero_and_nan)
+        {
+            util::thread_pool pool(3);
+            const double nan = std::numeric_limits < double > ::quiet_NaN();
+            size_t sizes[] = { 100, parallel_sort_threshold() * 2 + 3 };
+            for (size_t n : sizes)
+            for (int order = -1; order <= 1; ++order)
+            for (int parallel = 0; parallel < 2; ++parallel)
+            {
+                std::vector < double > data[3], original[3];
+                make_arrays(n, data);
+                for (size_t i = 0; i < n; i += 7) data[0][i] = nan;
+                for (size_t k = 0; k < 3; ++k) original[k] = data[k];
+                double * arrays[] = { data[0].data(), data[1].data(), data[2].data() };
+                if (parallel) sort_all(arrays, 3, n, pool, order, true);
+                else          sort_all(arrays, 3, n, order, true);
+
+                if (order == 0)
+                {
+                    Assert::IsTrue(data[1] == original[1], L"order 0 is a no-op", LINE_INFO());
+                    continue;
+                }
+                size_t first_nan = n;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    if (std::isnan(data[0][i])) { if (first_nan == n) first_nan = i; continue; }
+                    Assert::IsTrue(first_nan == n, L"NaN keys last", LINE_INFO());
+                    Assert::AreEqual(data[0][i] * 2 + 1, data[2][i], 0., L"rows kept together", LINE_INFO());
+                    if (i > 0) Assert::IsTrue(order * (data[0][i] - data[0][i - 1]) >= 0, L"order", LINE_INFO());
+                }
+                Assert::AreEqual((n + 6) / 7, n - first_nan, L"NaN count", LINE_INFO());
+                for (size_t i = first_nan + 1; i < n; ++i)
+                {
+                    Assert::IsTrue(data[1][i] > data[1][i - 1], L"NaN rows stable", LINE_INFO());
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_parallel)
+            TEST_DESCRIPTION(L"parallel sort_all matches the serial stable sort")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_parallel)
+        {
+            util::thread_pool pool(3);
+            size_t n = parallel_sort_threshold() * 3 + 7;
+            for (int order = -1; order <= 1; order += 2)
+            for (int stable = 0; stable < 2; ++stable)
+            {
+                std::vector < double > data[3], expected[3];
+                make_arrays(n, data);
+                make_arrays(n, expected);
+                double * arrays[] = { data[0].data(), data[1].data(), data[2].data() };
+                double * reference[] = { expected[0].data(), expected[1].data(), expected[2].data() };
+                sort_all(arrays, 3, n, pool, order, stable != 0);
+                sort_all(reference, 3, n, order, true);
+                check_sorted(data, order, stable != 0);
+                if (stable)
+                {
+                    Assert::IsTrue(data[1] == expected[1], L"same permutation", LINE_INFO());
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,143 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+#include <util/common/math/stft.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static std::vector < double > make_white_noise(size_t n)
+    {
+        std::vector < double > x(n);
+        srand(11);
+        for (size_t i = 0; i < n; ++i) x[i] = random();
+        return x;
+    }
+
+    TEST_CLASS(stft_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_windows)
+            TEST_DESCRIPTION(L"periodic windows have the expected shape")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_windows)
+        {
+            auto hann = make_window(hann_window, 8);
+            Assert::AreEqual(0., hann[0], 1e-15, L"hann start", LINE_INFO());
+            Assert::AreEqual(1., hann[4], 1e-15, L"hann peak", LINE_INFO());
+            Assert::AreEqual(hann[1], hann[7], 1e-15, L"hann symmetry", LINE_INFO());
+            auto hamming = make_window(hamming_window, 8);
+            Assert::AreEqual(0.08, hamming[0], 1e-15, L"hamming start", LINE_INFO());
+            auto bh = make_window(blackman_harris_window, 8);
+            Assert::AreEqual(6e-5, bh[0], 1e-15, L"blackman-harris start", LINE_INFO());
+            Assert::AreEqual(1., bh[4], 1e-15, L"blackman-harris peak", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_transform_matches_fft)
+            TEST_DESCRIPTION(L"STFT frames are the FFT of the windowed segments")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_transform_matches_fft)
+        {
+            auto x = make_white_noise(1000);
+            sampled_t sx = { x.data(), x.size(), 1 };
+            stft_plan plan(128, 96, blackman_harris_window);
+            size_t frames = plan.frame_count(x.size());
+            Assert::AreEqual((size_t) 28, frames, L"frames", LINE_INFO());
+
+            std::vector < complex < > > out(frames * plan.bins());
+            plan.transform(sx, out.data());
+            for (size_t f = 0; f < frames; f += 9)
+            {
+                std::vector < complex < > > seg(128);
+                for (size_t i = 0; i < 128; ++i) seg[i] = { x[f * 32 + i] * plan.get_window()[i], 0 };
+                fft_plan(128, -1).execute(seg.data());
+                for (size_t k = 0; k < plan.bins(); ++k)
+                {
+                    Assert::IsTrue(norm(seg[k] - out[f * plan.bins() + k]) < 1e-12, L"bin", LINE_INFO());
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_spectrogram_parseval)
+            TEST_DESCRIPTION(L"rectangular-window spectrogram rows integrate to the segment power")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_spectrogram_parseval)
+        {
+            auto x = make_white_noise(4096);
+            sampled_t sx = { x.data(), x.size(), 0.01 };
+            stft_plan plan(256, 0, rectangular_window);
+            std::vector < double > buf(16 * plan.bins());
+            sampled_grid_t grid = { buf.data(), 16, plan.bins(), 0, 0 };
+            plan.spectrogram(sx, grid);
+
+            Assert::AreEqual((size_t) 16, grid.rows, L"rows", LINE_INFO());
+            Assert::AreEqual(2.56, grid.row_period, 1e-12, L"frame step", LINE_INFO());
+            Assert::AreEqual(100. / 256, grid.col_period, 1e-12, L"bin width", LINE_INFO());
+            for (size_t f = 0; f < grid.rows; ++f)
+            {
+                sampled_t row = grid_row(grid, f);
+                double integral = 0, power = 0;
+                for (size_t k = 0; k < row.count; ++k) integral += row.samples[k] * row.period;
+                for (size_t i = 0; i < 256; ++i) power += x[f * 256 + i] * x[f * 256 + i];
+                Assert::AreEqual(power / 256, integral, 1e-12, L"parseval", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_welch)
+            TEST_DESCRIPTION(L"Welch PSD of white noise is flat, the pool gives identical results")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_welch)
+        {
+            /* uniform [-1, 1]: variance 1/3, one-sided density 2/3 / fs */
+            auto x = make_white_noise(1 << 16);
+            sampled_t sx = { x.data(), x.size(), 0.5 };
+            stft_plan plan(512, 256);
+            std::vector < double > serial(plan.bins()), parallel(plan.bins()), median(plan.bins());
+            sampled_t s1 = { serial.data(), serial.size(), 0 };
+            sampled_t s2 = { parallel.data(), parallel.size(), 0 };
+            sampled_t s3 = { median.data(), median.size(), 0 };
+            util::thread_pool pool(3);
+            plan.welch(sx, s1);
+            plan.welch(sx, s2, pool);
+            plan.welch(sx, s3, pool, median_average);
+
+            Assert::AreEqual(2. / 512, s1.period, 1e-15, L"bin width", LINE_INFO());
+            double mean = 0, mean_median = 0;
+            for (size_t k = 1; k + 1 < plan.bins(); ++k)
+            {
+                Assert::AreEqual(serial[k], parallel[k], 0., L"deterministic", LINE_INFO());
+                mean += serial[k]; mean_median += median[k];
+            }
+            mean /= plan.bins() - 2; mean_median /= plan.bins() - 2;
+            Assert::AreEqual(2. / 3 * 0.5, mean, 0.01, L"level", LINE_INFO());
+            Assert::AreEqual(mean, mean_median, 0.02, L"median level", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_welch_tone)
+            TEST_DESCRIPTION(L"Welch PSD peaks at the bin of a tone")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_welch_tone)
+        {
+            std::vector < double > x(8192), psd(129);
+            for (size_t i = 0; i < x.size(); ++i) x[i] = std::sin(2 * M_PI * 50 * i / 1000.);
+            sampled_t sx = { x.data(), x.size(), 1e-3 }, sp = { psd.data(), psd.size(), 0 };
+            stft_plan plan(256, 128, hamming_window);
+            plan.welch(sx, sp);
+            size_t peak = std::max_element(psd.begin(), psd.end()) - psd.begin();
+            Assert::AreEqual(50., peak * sp.period, sp.period, L"peak frequency", LINE_INFO());
+        }
+    };
+}
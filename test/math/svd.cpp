@@ -0,0 +1,329 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+#include <util/common/math/common.h>
+#include <util/common/math/svd_hest.h>
+#include <util/common/math/svd.h>
+#include <util/common/thread_pool.h>
+
+#include "bench.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace math
+{
+
+    static std::vector < double > random_matrix(int m, int n, unsigned seed)
+    {
+        srand(seed);
+        std::vector < double > a(m * n);
+        for (auto & x : a) x = random() * 2 - 1;
+        return a;
+    }
+
+    /* max |a - u diag(sigma) v^T| and max |u_i . u_j| (i != j) */
+    static void check_decomposition(int m, int n, const std::vector < double > & a,
+                                    const svd_workspace & w)
+    {
+        for (int i = 0; i < m; ++i)
+        for (int j = 0; j < n; ++j)
+        {
+            double s = 0;
+            for (int c = 0; c < n; ++c) s += w.u(i, c) * w.sigma()[c] * w.v(j, c);
+            Assert::AreEqual(a[i * n + j], s, 1e-10, L"reconstruction", LINE_INFO());
+        }
+        for (int c = 0; c + 1 < n; ++c)
+        {
+            Assert::IsTrue(w.sigma()[c] >= w.sigma()[c + 1], L"sorted", LINE_INFO());
+            for (int d = c + 1; d < n; ++d)
+            {
+                double s = 0;
+                for (int i = 0; i < m; ++i) s += w.u(i, c) * w.u(i, d);
+                Assert::IsTrue(std::abs(s) < svd_workspace::threshold(), L"orthogonal", LINE_INFO());
+            }
+        }
+    }
+
+    /* column-major `rows x cols` with orthonormal columns */
+    static std::vector < double > random_orthonormal(int rows, int cols, unsigned seed)
+    {
+        auto q = random_matrix(rows, cols, seed);
+        for (int c = 0; c < cols; ++c)
+        {
+            double * x = q.data() + c * rows;
+            for (int pass = 0; pass < 2; ++pass)
+            for (int j = 0; j < c; ++j)
+            {
+                const double * y = q.data() + j * rows;
+                double d = 0;
+                for (int i = 0; i < rows; ++i) d += x[i] * y[i];
+                for (int i = 0; i < rows; ++i) x[i] -= d * y[i];
+            }
+            double s = 0;
+            for (int i = 0; i < rows; ++i) s += x[i] * x[i];
+            for (int i = 0; i < rows; ++i) x[i] /= std::sqrt(s);
+        }
+        return q;
+    }
+
+    TEST_CLASS(svd_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_matches_svd_hestenes)
+            TEST_DESCRIPTION(L"svd_workspace reproduces svd_hestenes on all instruction sets")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_matches_svd_hestenes)
+        {
+            int m = 23, n = 13;
+            auto a = random_matrix(m, n, 1);
+            std::vector < double > a0(a), u0(m * n), v0(n * n), s0(n);
+            svd_hestenes(m, n, a0.data(), u0.data(), v0.data(), s0.data());
+
+            simd::level isas[] = { simd::scalar, simd::sse2, simd::avx };
+            svd_workspace w;
+            for (size_t q = 0; q < sizeof(isas) / sizeof(isas[0]); ++q)
+            {
+                svd_workspace wi(isas[q]);
+                Assert::IsTrue(wi.decompose(m, n, a.data()) > 0, L"converged", LINE_INFO());
+                check_decomposition(m, n, a, wi);
+                for (int c = 0; c < n; ++c)
+                {
+                    Assert::AreEqual(s0[c], wi.sigma()[c], 1e-8 * s0[0], L"sigma", LINE_INFO());
+                }
+            }
+
+            /* the drop-in form, same layout */
+            std::vector < double > u(m * n), v(n * n), s(n);
+            Assert::IsTrue(svd_jacobi(m, n, a.data(), u.data(), v.data(), s.data()) > 0, L"converged", LINE_INFO());
+            for (int i = 0; i < m; ++i)
+            for (int c = 0; c < n; ++c)
+            {
+                /* singular vectors are defined up to the sign */
+                double sign = (u[c] * u0[c] < 0) ? -1 : 1;
+                Assert::AreEqual(u0[i * n + c], sign * u[i * n + c], 1e-4, L"u", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_reuse_and_toeplitz)
+            TEST_DESCRIPTION(L"svd_workspace is reusable across sizes and handles svd_toepliz input")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_reuse_and_toeplitz)
+        {
+            svd_workspace w;
+            int sizes[][2] = { { 9, 9 }, { 40, 7 }, { 5, 5 }, { 31, 17 } };
+            for (size_t q = 0; q < 4; ++q)
+            {
+                int m = sizes[q][0], n = sizes[q][1];
+                auto a = random_matrix(m, n, (unsigned) q + 2);
+                Assert::IsTrue(w.decompose(m, n, a.data()) > 0, L"converged", LINE_INFO());
+                check_decomposition(m, n, a, w);
+            }
+
+            int n = 16;
+            std::vector < double > t(n), u0(n * n), v0(n * n), s0(n), a(n * n);
+            for (int i = 0; i < n; ++i) t[i] = std::exp(-0.3 * i) * std::cos(0.7 * i);
+            for (int i = 0; i < n; ++i) for (int j = 0; j < n; ++j) a[i * n + j] = t[std::abs(i - j)];
+            svd_toepliz(n, n, t.data(), u0.data(), v0.data(), s0.data());
+            Assert::IsTrue(w.decompose_toeplitz(n, n, t.data()) > 0, L"converged", LINE_INFO());
+            check_decomposition(n, n, a, w);
+            for (int c = 0; c < n; ++c)
+            {
+                Assert::AreEqual(s0[c], w.sigma()[c], 1e-8 * s0[0], L"sigma", LINE_INFO());
+            }
+
+            /* without `v` the singular values stay the same */
+            w.decompose_toeplitz(n, n, t.data(), false);
+            Assert::IsFalse(w.has_v(), L"no v", LINE_INFO());
+            for (int c = 0; c < n; ++c)
+            {
+                Assert::AreEqual(s0[c], w.sigma()[c], 1e-8 * s0[0], L"sigma", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_parallel_round_robin)
+            TEST_DESCRIPTION(L"round-robin sweeps on a thread_pool converge to the serial result regardless of the worker count")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_parallel_round_robin)
+        {
+            int sizes[][2] = { { 30, 16 }, { 25, 11 }, { 1, 1 } };
+            util::thread_pool one(1), four(4);
+            for (size_t q = 0; q < 3; ++q)
+            {
+                int m = sizes[q][0], n = sizes[q][1];
+                auto a = random_matrix(m, n, (unsigned) q + 7);
+                svd_workspace serial, w1, w4;
+                int iter = serial.decompose(m, n, a.data());
+                Assert::IsTrue(iter > 0, L"converged", LINE_INFO());
+                Assert::AreEqual(iter, serial.stats().sweeps, L"sweeps", LINE_INFO());
+
+                int iter1 = w1.decompose(m, n, a.data(), one);
+                int iter4 = w4.decompose(m, n, a.data(), four);
+                Assert::IsTrue(iter1 > 0, L"converged", LINE_INFO());
+                Assert::AreEqual(iter1, iter4, L"same sweeps", LINE_INFO());
+                Assert::AreEqual(iter4, w4.stats().sweeps, L"sweeps", LINE_INFO());
+                Assert::IsTrue(w4.stats().rotations == w1.stats().rotations, L"same rotations", LINE_INFO());
+                Assert::IsTrue(w4.stats().seconds >= 0, L"timed", LINE_INFO());
+                check_decomposition(m, n, a, w4);
+
+                /* another rotation order leaves another O(threshold^2) residual */
+                for (int c = 0; c < n; ++c)
+                {
+                    Assert::AreEqual(serial.sigma()[c], w4.sigma()[c], 1e-6 * serial.sigma()[0], L"sigma", LINE_INFO());
+                    Assert::IsTrue(w1.sigma()[c] == w4.sigma()[c], L"deterministic", LINE_INFO());
+                    for (int i = 0; i < m; ++i)
+                    {
+                        Assert::IsTrue(w1.u(i, c) == w4.u(i, c), L"deterministic", LINE_INFO());
+                    }
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_truncated_svd)
+            TEST_DESCRIPTION(L"truncated_svd recovers the leading triplets of a matrix with known spectrum")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_truncated_svd)
+        {
+            int m = 200, n = 60, k = 6;
+            auto x = random_orthonormal(m, n, 11), y = random_orthonormal(n, n, 12);
+            std::vector < double > s(n), a(m * n, 0.);
+            for (int c = 0; c < n; ++c) s[c] = 10 * std::pow(0.6, c);
+            for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+            for (int c = 0; c < n; ++c)
+            {
+                a[i * n + j] += x[c * m + i] * s[c] * y[c * n + j];
+            }
+
+            truncated_svd t;
+            Assert::IsTrue(t.decompose(m, n, a.data(), k) > 0, L"converged", LINE_INFO());
+            Assert::AreEqual(k, t.rank(), L"rank", LINE_INFO());
+            for (int c = 0; c < k; ++c)
+            {
+                Assert::AreEqual(s[c], t.sigma()[c], 1e-8 * s[0], L"sigma", LINE_INFO());
+                double du = 0, dv = 0;
+                for (int i = 0; i < m; ++i) du += t.u(i, c) * x[c * m + i];
+                for (int j = 0; j < n; ++j) dv += t.v(j, c) * y[c * n + j];
+                Assert::AreEqual(1., std::abs(du), 1e-6, L"u", LINE_INFO());
+                Assert::AreEqual(1., std::abs(dv), 1e-6, L"v", LINE_INFO());
+                Assert::IsTrue(du * dv > 0, L"consistent signs", LINE_INFO());
+            }
+
+            /* no `v`, same seed: the same `sigma` and `u` */
+            truncated_svd w;
+            Assert::IsTrue(w.decompose(m, n, a.data(), k, false) > 0, L"converged", LINE_INFO());
+            Assert::IsFalse(w.has_v(), L"no v", LINE_INFO());
+            for (int c = 0; c < k; ++c)
+            {
+                Assert::AreEqual(t.sigma()[c], w.sigma()[c], 1e-12, L"sigma", LINE_INFO());
+                for (int i = 0; i < m; ++i) Assert::AreEqual(t.u(i, c), w.u(i, c), 1e-12, L"u", LINE_INFO());
+            }
+
+            /* a rank-deficient matrix: the sketch exceeds the rank */
+            std::vector < double > b(m * n, 0.);
+            for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+            for (int c = 0; c < 3; ++c)
+            {
+                b[i * n + j] += x[c * m + i] * s[c] * y[c * n + j];
+            }
+            Assert::IsTrue(t.decompose(m, n, b.data(), 5) > 0, L"converged", LINE_INFO());
+            for (int c = 0; c < 3; ++c) Assert::AreEqual(s[c], t.sigma()[c], 1e-8 * s[0], L"sigma", LINE_INFO());
+            for (int c = 3; c < 5; ++c) Assert::AreEqual(0., t.sigma()[c], 1e-8 * s[0], L"null", LINE_INFO());
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_jacobi_vs_hestenes)
+            TEST_DESCRIPTION(L"column-major svd_workspace vs row-major svd_hestenes, n x n")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_jacobi_vs_hestenes)
+        {
+            Logger::WriteMessage("       n  hestenes, us  workspace, us\n");
+            for (int n = 64; n <= 512; n <<= 1)
+            {
+                std::vector < double > a(n * n), b(n * n), u(n * n), v(n * n), sigma(n);
+                for (auto & x : a) x = random();
+                svd_workspace w;
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << n
+                   << std::setw(14) << bench([&] ()
+                      {
+                          b = a;
+                          svd_hestenes(n, n, b.data(), u.data(), v.data(), sigma.data());
+                      })
+                   << std::setw(15) << bench([&] () { w.decompose(n, n, a.data()); })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_jacobi_serial_vs_parallel)
+            TEST_DESCRIPTION(L"svd_workspace cyclic sweeps vs round-robin sweeps on a thread_pool, n x n")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_jacobi_serial_vs_parallel)
+        {
+            util::thread_pool pool;
+            std::ostringstream head;
+            head << "  workers: " << pool.size() << std::endl
+                 << "       n  sweeps  serial, s  sweeps  parallel, s" << std::endl;
+            Logger::WriteMessage(head.str().c_str());
+            for (int n = 128; n <= 1024; n <<= 1)
+            {
+                std::vector < double > a(n * n);
+                for (auto & x : a) x = random();
+                svd_workspace serial, parallel;
+                serial.decompose(n, n, a.data());
+                parallel.decompose(n, n, a.data(), pool);
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(3)
+                   << std::setw(8) << n
+                   << std::setw(8) << serial.stats().sweeps
+                   << std::setw(11) << serial.stats().seconds
+                   << std::setw(8) << parallel.stats().sweeps
+                   << std::setw(13) << parallel.stats().seconds
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_truncated_vs_full_svd)
+            TEST_DESCRIPTION(L"top-10 triplets by truncated_svd vs the full svd_workspace, m x 200")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_truncated_vs_full_svd)
+        {
+            Logger::WriteMessage("       m      full, us  truncated, us\n");
+            int n = 200;
+            for (int m = 500; m <= 4000; m <<= 1)
+            {
+                std::vector < double > a(m * n);
+                for (auto & x : a) x = random();
+                svd_workspace w;
+                truncated_svd t;
+                std::ostringstream os;
+                os << std::fixed << std::setprecision(2)
+                   << std::setw(8) << m
+                   << std::setw(14) << bench([&] () { w.decompose(m, n, a.data()); })
+                   << std::setw(15) << bench([&] () { t.decompose(m, n, a.data(), 10); })
+                   << std::endl;
+                Logger::WriteMessage(os.str().c_str());
+            }
+        }
+    };
+}
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+#include <util/common/thread_pool.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace util
+{
+
+    TEST_CLASS(thread_pool_test)
+    {
+    public:
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_run_all_tasks)
+            TEST_DESCRIPTION(L"every task runs exactly once on a valid worker")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_run_all_tasks)
+        {
+            thread_pool pool(4);
+            Assert::AreEqual((size_t) 4, pool.size(), L"size", LINE_INFO());
+
+            for (size_t r = 0; r < 10; ++r)
+            {
+                std::vector < int > hits(1000, 0);
+                std::atomic < bool > bad_worker(false);
+                pool.run(hits.size(), [&] (size_t t, size_t w)
+                {
+                    if (w >= pool.size()) bad_worker = true;
+                    ++hits[t];
+                });
+                Assert::IsFalse(bad_worker, L"worker index", LINE_INFO());
+                for (size_t t = 0; t < hits.size(); ++t)
+                {
+                    Assert::AreEqual(1, hits[t], L"hits", LINE_INFO());
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_single_worker)
+            TEST_DESCRIPTION(L"single-worker pool runs tasks on the calling thread")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_single_worker)
+        {
+            thread_pool pool(1);
+            std::vector < size_t > order;
+            pool.run(5, [&] (size_t t, size_t w) { order.push_back(t + w); });
+            Assert::AreEqual((size_t) 5, order.size(), L"count", LINE_INFO());
+            for (size_t t = 0; t < order.size(); ++t)
+            {
+                Assert::AreEqual(t, order[t], L"order", LINE_INFO());
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(_rethrow)
+            TEST_DESCRIPTION(L"task exception is rethrown by run")
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD(_rethrow)
+        {
+            thread_pool pool(3);
+            bool thrown = false;
+            try
+            {
+                pool.run(100, [] (size_t t, size_t)
+                {
+                    if (t == 42) throw std::runtime_error("42");
+                });
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+            Assert::IsTrue(thrown, L"thrown", LINE_INFO());
+
+            std::atomic < size_t > sum(0);
+            pool.run(10, [&] (size_t t, size_t) { sum += t; });
+            Assert::AreEqual((size_t) 45, (size_t) sum, L"usable after exception", LINE_INFO());
+        }
+    };
+}